@@ -0,0 +1,182 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <string_view>
+#include "nlohmann/json.hpp"
+#include "Bench.hpp"
+
+Bench::Options Bench::parseArguments(int32_t argc, char** argv)
+{
+	Options options;
+
+	for (int32_t i = 1; i < argc; ++i)
+	{
+		std::string_view argument = argv[i];
+
+		if (argument == "--filter" && i + 1 < argc)
+		{
+			options.filter = argv[++i];
+		}
+		else if (argument == "--format" && i + 1 < argc)
+		{
+			std::string_view format = argv[++i];
+			if (format == "json") options.format = Format::Json;
+			else if (format == "csv") options.format = Format::Csv;
+			else options.format = Format::Table;
+		}
+		else if (argument == "--output" && i + 1 < argc)
+		{
+			options.output = argv[++i];
+		}
+		else if (argument == "--min-time" && i + 1 < argc)
+		{
+			options.minTime = std::stod(argv[++i]);
+		}
+		else if (argument == "--samples" && i + 1 < argc)
+		{
+			options.samples = std::max<size_t>(std::stoul(argv[++i]), 1);
+		}
+		else if (argument == "--workers" && i + 1 < argc)
+		{
+			options.workerCount = std::stoul(argv[++i]);
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << argument << std::endl;
+		}
+	}
+
+	return options;
+}
+
+void Bench::Runner::add(std::string name, Case function)
+{
+	m_Entries.push_back(Entry{ std::move(name), std::move(function) });
+}
+
+Bench::Result Bench::Runner::measure(const Entry& entry, const Options& options) const
+{
+	const double sampleTime = options.minTime / options.samples * 1e9;
+
+	// Grow the iteration count until a single sample lasts long enough to trust the clock
+	size_t iterations = 1;
+	while (true)
+	{
+		State state(iterations);
+		entry.function(state);
+
+		double elapsed = state.elapsedNanoseconds();
+		if (elapsed >= sampleTime || iterations >= (size_t)1 << 30) break;
+
+		double scale = elapsed > 0.0 ? sampleTime / elapsed * 1.2 : 10.0;
+		iterations = (size_t)(iterations * std::clamp(scale, 2.0, 10.0));
+	}
+
+	std::vector<double> perIteration;
+	size_t itemsPerIteration = 1;
+
+	for (size_t sample = 0; sample < options.samples; ++sample)
+	{
+		State state(iterations);
+		entry.function(state);
+
+		perIteration.push_back(state.elapsedNanoseconds() / iterations);
+		itemsPerIteration = state.itemsPerIteration();
+	}
+
+	std::sort(perIteration.begin(), perIteration.end());
+
+	Result result;
+	result.name = entry.name;
+	result.iterations = iterations;
+	result.nanosecondsMedian = perIteration[perIteration.size() / 2];
+	result.nanosecondsMin = perIteration.front();
+	result.nanosecondsMax = perIteration.back();
+	result.itemsPerSecond = result.nanosecondsMedian > 0.0 ?
+		itemsPerIteration * 1e9 / result.nanosecondsMedian : 0.0;
+
+	return result;
+}
+
+static void writeTable(std::ostream& os, const std::vector<Bench::Result>& results)
+{
+	os << std::left << std::setw(48) << "case"
+		<< std::right << std::setw(14) << "ns/iter"
+		<< std::setw(14) << "min"
+		<< std::setw(14) << "max"
+		<< std::setw(16) << "items/s" << '\n';
+
+	for (const auto& result : results)
+	{
+		os << std::left << std::setw(48) << result.name
+			<< std::right << std::fixed << std::setprecision(1)
+			<< std::setw(14) << result.nanosecondsMedian
+			<< std::setw(14) << result.nanosecondsMin
+			<< std::setw(14) << result.nanosecondsMax
+			<< std::setprecision(0) << std::setw(16) << result.itemsPerSecond << '\n';
+	}
+}
+
+static void writeJson(std::ostream& os, const std::vector<Bench::Result>& results)
+{
+	nlohmann::json output = nlohmann::json::array();
+
+	for (const auto& result : results)
+	{
+		output.push_back({
+			{ "name", result.name },
+			{ "iterations", result.iterations },
+			{ "nsPerIterationMedian", result.nanosecondsMedian },
+			{ "nsPerIterationMin", result.nanosecondsMin },
+			{ "nsPerIterationMax", result.nanosecondsMax },
+			{ "itemsPerSecond", result.itemsPerSecond }
+		});
+	}
+
+	os << output.dump(4) << '\n';
+}
+
+static void writeCsv(std::ostream& os, const std::vector<Bench::Result>& results)
+{
+	os << "name,iterations,ns_per_iteration_median,ns_per_iteration_min,ns_per_iteration_max,items_per_second\n";
+
+	for (const auto& result : results)
+	{
+		os << result.name << ','
+			<< result.iterations << ','
+			<< result.nanosecondsMedian << ','
+			<< result.nanosecondsMin << ','
+			<< result.nanosecondsMax << ','
+			<< result.itemsPerSecond << '\n';
+	}
+}
+
+void Bench::Runner::run(const Options& options)
+{
+	std::vector<Result> results;
+
+	for (const auto& entry : m_Entries)
+	{
+		if (entry.name.find(options.filter) == std::string::npos) continue;
+
+		results.push_back(measure(entry, options));
+		// Progress goes to stderr so piped JSON or CSV stays clean
+		std::cerr << entry.name << ": " << results.back().nanosecondsMedian << " ns" << std::endl;
+	}
+
+	std::ofstream file;
+	if (!options.output.empty())
+	{
+		file.open(options.output);
+		if (!file) std::cerr << "Could not open " << options.output << std::endl;
+	}
+	std::ostream& os = file.is_open() ? file : std::cout;
+
+	switch (options.format)
+	{
+	case Format::Table: writeTable(os, results); break;
+	case Format::Json: writeJson(os, results); break;
+	case Format::Csv: writeCsv(os, results); break;
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include "nlohmann/json.hpp"
+
+namespace Bench
+{
+	// Keeps the compiler from discarding a computed value or hoisting it out of a loop
+	template <typename T>
+	inline void doNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* s_Sink;
+		s_Sink = &value;
+#endif
+	}
+
+	class State
+	{
+	public:
+
+		using Clock = std::chrono::steady_clock;
+
+		explicit State(size_t iterations) : m_Iterations(iterations) {}
+
+		size_t iterations() const { return m_Iterations; }
+
+		// Excludes per-iteration setup, like refilling a container, from the measurement
+		void pauseTiming() { m_PauseStart = Clock::now(); }
+		void resumeTiming() { m_Paused += Clock::now() - m_PauseStart; }
+
+		// Items handled by a single iteration, used to report throughput
+		void setItemsPerIteration(size_t items) { m_ItemsPerIteration = items; }
+		size_t itemsPerIteration() const { return m_ItemsPerIteration; }
+
+		double elapsedNanoseconds() const
+		{
+			return std::chrono::duration<double, std::nano>(m_Stop - m_Start - m_Paused).count();
+		}
+
+		class Iterator
+		{
+		public:
+
+			Iterator(State* state, size_t remaining) : m_State(state), m_Remaining(remaining) {}
+
+			size_t operator*() const { return m_Remaining; }
+
+			Iterator& operator++()
+			{
+				--m_Remaining;
+				return *this;
+			}
+
+			bool operator!=(const Iterator&)
+			{
+				if (m_Remaining) return true;
+
+				m_State->m_Stop = Clock::now();
+				return false;
+			}
+
+		private:
+
+			State* m_State;
+			size_t m_Remaining;
+		};
+
+		// The timed region is the range-for loop over the state itself
+		Iterator begin()
+		{
+			m_Start = Clock::now();
+			return Iterator(this, m_Iterations);
+		}
+
+		Iterator end() { return Iterator(this, 0); }
+
+	private:
+
+		size_t m_Iterations;
+		size_t m_ItemsPerIteration = 1;
+		Clock::time_point m_Start;
+		Clock::time_point m_Stop;
+		Clock::time_point m_PauseStart;
+		Clock::duration m_Paused{ 0 };
+	};
+
+	using Case = std::function<void(State&)>;
+
+	struct Result
+	{
+		std::string name;
+		size_t iterations = 0;
+		double nanosecondsMedian = 0.0;
+		double nanosecondsMin = 0.0;
+		double nanosecondsMax = 0.0;
+		double itemsPerSecond = 0.0;
+	};
+
+	enum class Format { Table, Json, Csv };
+
+	struct Options
+	{
+		std::string filter;
+		Format format = Format::Table;
+		std::string output;
+		double minTime = 0.1;
+		size_t samples = 5;
+		size_t workerCount = 0;
+	};
+
+	Options parseArguments(int32_t argc, char** argv);
+
+	class Runner
+	{
+	public:
+
+		void add(std::string name, Case function);
+		// Runs every case whose name contains the filter and writes the results
+		void run(const Options& options);
+
+	private:
+
+		struct Entry
+		{
+			std::string name;
+			Case function;
+		};
+
+		Result measure(const Entry& entry, const Options& options) const;
+
+		std::vector<Entry> m_Entries;
+	};
+
+	// Bordered square map with a sparse grid of pillars, for long unobstructed rays
+	nlohmann::json generateOpenMap(int32_t size);
+
+	void registerWorldCases(Runner& runner);
+	void registerEntityCases(Runner& runner);
+	void registerCollisionCases(Runner& runner);
+	// Whole software frames, with and without fog
+	void registerRenderCases(Runner& runner);
+}
@@ -0,0 +1,66 @@
+#include <random>
+#include "Bench.hpp"
+#include "Core.hpp"
+
+static constexpr size_t k_Shapes = 1024;
+
+// Pairs are placed around a unit cell so roughly half of them overlap
+template <typename A, typename B, typename Make>
+static void addResolveCase(Bench::Runner& runner, const std::string& name, Make make)
+{
+	runner.add("resolve/" + name, [make](Bench::State& state)
+	{
+		std::mt19937 random(4);
+		std::vector<A> first;
+		std::vector<B> second;
+
+		for (size_t i = 0; i < k_Shapes; ++i)
+		{
+			auto [a, b] = make(random);
+			first.push_back(a);
+			second.push_back(b);
+		}
+
+		for ([[maybe_unused]] auto _ : state)
+		{
+			Vec2 total;
+			for (size_t i = 0; i < k_Shapes; ++i)
+			{
+				total += first[i].resolve(second[i]);
+			}
+			Bench::doNotOptimize(total);
+		}
+
+		state.setItemsPerIteration(k_Shapes);
+	});
+}
+
+void Bench::registerCollisionCases(Runner& runner)
+{
+	using Random = std::mt19937;
+
+	auto offset = [](Random& random)
+	{
+		return std::uniform_real_distribution<float>(-0.6f, 1.6f)(random);
+	};
+
+	addResolveCase<Cir, Rect>(runner, "circleRect", [offset](Random& random)
+	{
+		return std::pair(Cir(offset(random), offset(random), 0.3f), Rect(0.0f, 0.0f, 1.0f, 1.0f));
+	});
+
+	addResolveCase<Rect, Cir>(runner, "rectCircle", [offset](Random& random)
+	{
+		return std::pair(Rect(0.0f, 0.0f, 1.0f, 1.0f), Cir(offset(random), offset(random), 0.3f));
+	});
+
+	addResolveCase<Rect, Rect>(runner, "rectRect", [offset](Random& random)
+	{
+		return std::pair(Rect(offset(random), offset(random), 0.6f, 0.6f), Rect(0.0f, 0.0f, 1.0f, 1.0f));
+	});
+
+	addResolveCase<Cir, Cir>(runner, "circleCircle", [offset](Random& random)
+	{
+		return std::pair(Cir(offset(random), offset(random), 0.3f), Cir(0.5f, 0.5f, 0.3f));
+	});
+}
@@ -0,0 +1,389 @@
+#include <memory>
+#include <random>
+#include <numeric>
+#include <cmath>
+#include "Bench.hpp"
+#include "SparseSet.hpp"
+#include "Systems.hpp"
+#include "Jobs.hpp"
+#include "Memory.hpp"
+
+static constexpr size_t k_IdRange = 65536;
+
+using TransformSet = SparseSet<Comp::Transform>;
+
+// Ids spread over the whole id range, as they would be after a long session of spawning
+static std::vector<Entity> shuffledIds(size_t count, uint32_t seed)
+{
+	std::vector<Entity> ids(k_IdRange);
+	std::iota(ids.begin(), ids.end(), 0);
+	std::shuffle(ids.begin(), ids.end(), std::mt19937(seed));
+	ids.resize(count);
+	return ids;
+}
+
+static void registerSparseSetCases(Bench::Runner& runner)
+{
+	for (size_t percent : { 1, 10, 50, 100 })
+	{
+		const size_t count = k_IdRange * percent / 100;
+		const std::string fill = std::to_string(percent) + "%";
+
+		runner.add("sparseSet/insert/" + fill, [count](Bench::State& state)
+		{
+			auto set = std::make_unique<TransformSet>();
+			auto ids = shuffledIds(count, 1);
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				state.pauseTiming();
+				set->clear();
+				state.resumeTiming();
+
+				for (Entity id : ids)
+				{
+					set->insert(id, Comp::Transform(Vec2((float)id, 0.0f)));
+				}
+				Bench::doNotOptimize(set->size());
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		runner.add("sparseSet/pop/" + fill, [count](Bench::State& state)
+		{
+			auto set = std::make_unique<TransformSet>();
+			auto ids = shuffledIds(count, 1);
+			auto popOrder = ids;
+			std::shuffle(popOrder.begin(), popOrder.end(), std::mt19937(2));
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				state.pauseTiming();
+				set->clear();
+				for (Entity id : ids) set->insert(id, Comp::Transform());
+				state.resumeTiming();
+
+				for (Entity id : popOrder)
+				{
+					set->pop(id);
+				}
+				Bench::doNotOptimize(set->size());
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		runner.add("sparseSet/iterate/" + fill, [count](Bench::State& state)
+		{
+			auto set = std::make_unique<TransformSet>();
+			for (Entity id : shuffledIds(count, 1)) set->insert(id, Comp::Transform(Vec2(1.0f, 2.0f)));
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Vec2 sum;
+				for (const auto& [id, transform] : *set)
+				{
+					sum += transform.position;
+				}
+				Bench::doNotOptimize(sum);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+	}
+}
+
+// Scatters moving colliders over the free cells of an open map, or of a square
+// in its corner when extent is smaller than the map
+static std::shared_ptr<GameContext> populateContext(size_t count, float extent = 254.0f, float radius = 0.3f)
+{
+	auto context = std::make_shared<GameContext>();
+	context->level.load(Bench::generateOpenMap(256));
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> coordinate(1.0f, 1.0f + extent);
+	std::uniform_real_distribution<float> speed(-3.0f, 3.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 2.0f * std::numbers::pi_v<float>);
+
+	auto& entities = context->entities;
+
+	while (count)
+	{
+		Vec2 position(coordinate(random), coordinate(random));
+		if (context->level.tile(position.y, position.x).isSolid()) continue;
+
+		Entity id = entities.spawn();
+		entities.add<Comp::Transform>(id, position);
+		// Half of them steer so both the speeding up and the slowing down paths run
+		Vec2 direction = count % 2 ? Vec2::direction(angle(random)) : Vec2();
+		entities.add<Comp::Velocity>(id, 3.0f, 20.0f, 20.0f, Vec2(speed(random), speed(random)), direction);
+		entities.add<Comp::Collider>(id, radius);
+		--count;
+	}
+
+	return context;
+}
+
+static void registerSystemCases(Bench::Runner& runner)
+{
+	for (size_t count : { 10, 100, 1000, 10000, 100000 })
+	{
+		auto context = populateContext(count);
+		const std::string population = std::to_string(count);
+
+		runner.add("systems/resolveWorldColisions/" + population, [context, count](Bench::State& state)
+		{
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Systems::resolveWorldColisions(*context);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		// Spread this thin they rarely touch, so this is mostly the broadphase
+		runner.add("systems/resolveEntityColisions/" + population, [context, count](Bench::State& state)
+		{
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Systems::resolveEntityColisions(*context);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		runner.add("systems/applyVelocity/" + population, [context, count](Bench::State& state)
+		{
+			// Alternating the sign keeps everyone near their starting cell across iterations
+			float dt = 1.0f / 60.0f;
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Systems::applyVelocity(*context, dt);
+				dt = -dt;
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		// Same walk as applyVelocity plus a sweep per collider
+		runner.add("systems/moveAndSlide/" + population, [context, count](Bench::State& state)
+		{
+			float dt = 1.0f / 60.0f;
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Systems::moveAndSlide(*context, dt);
+				// Its scratch lives in the frame arena, every iteration stands for a frame
+				Memory::frameArena().reset();
+				dt = -dt;
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		runner.add("systems/accelerate/" + population, [context, count](Bench::State& state)
+		{
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Systems::accelerate(*context, 1.0f / 60.0f);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		// The same Transform and Velocity walk through each way of joining two sets
+		runner.add("entities/lookup/" + population, [context, count](Bench::State& state)
+		{
+			auto& entities = context->entities;
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Vec2 sum;
+				for (const auto& [id, velocity] : entities.getSet<Comp::Velocity>())
+				{
+					if (!entities.has<Comp::Transform>(id)) continue;
+					sum += entities.get<Comp::Transform>(id).position + velocity.current;
+				}
+				Bench::doNotOptimize(sum);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		runner.add("entities/view/" + population, [context, count](Bench::State& state)
+		{
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Vec2 sum;
+				context->entities.view<Comp::Transform, Comp::Velocity>().each(
+					[&sum](Entity, const auto& transform, const auto& velocity)
+					{
+						sum += transform.position + velocity.current;
+					});
+				Bench::doNotOptimize(sum);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		runner.add("entities/group/" + population, [context, count](Bench::State& state)
+		{
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Vec2 sum;
+				context->entities.group<Comp::Transform, Comp::Velocity>().each(
+					[&sum](Entity, const auto& transform, const auto& velocity)
+					{
+						sum += transform.position + velocity.current;
+					});
+				Bench::doNotOptimize(sum);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+	}
+}
+
+// The same population with ever bigger colliders, more of them touch the pillars and walls
+static void registerColliderSizeCases(Bench::Runner& runner)
+{
+	constexpr size_t k_Count = 10000;
+
+	for (float radius : { 0.3f, 1.0f, 2.0f, 4.0f })
+	{
+		auto context = populateContext(k_Count, 254.0f, radius);
+
+		std::vector<std::pair<Entity, Vec2>> starting;
+		for (auto [id, transform] : context->entities.getSet<Comp::Transform>())
+		{
+			starting.emplace_back(id, transform.position);
+		}
+
+		const std::string name = "systems/resolveWorldColisions/radius" + std::to_string(radius).substr(0, 3) + "/" + std::to_string(k_Count);
+		runner.add(name, [context, starting](Bench::State& state)
+		{
+			auto& entities = context->entities;
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				state.pauseTiming();
+				for (const auto& [id, position] : starting)
+				{
+					entities.get<Comp::Transform>(id).position = position;
+				}
+				state.resumeTiming();
+
+				Systems::resolveWorldColisions(*context);
+			}
+
+			state.setItemsPerIteration(k_Count);
+		});
+	}
+}
+
+// Crowds of about four colliders per free cell, nearly all of them overlapping
+static void registerCrowdCases(Bench::Runner& runner)
+{
+	for (size_t count : { 1000, 10000 })
+	{
+		auto context = populateContext(count, std::sqrt(count / 4.0f));
+
+		std::vector<std::pair<Entity, Vec2>> starting;
+		for (auto [id, transform] : context->entities.getSet<Comp::Transform>())
+		{
+			starting.emplace_back(id, transform.position);
+		}
+
+		runner.add("systems/resolveEntityColisions/crowd/" + std::to_string(count), [context, starting, count](Bench::State& state)
+		{
+			auto& entities = context->entities;
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				// Resolving spreads the crowd, putting it back keeps every iteration the same work
+				state.pauseTiming();
+				for (const auto& [id, position] : starting)
+				{
+					entities.get<Comp::Transform>(id).position = position;
+				}
+				state.resumeTiming();
+
+				Systems::resolveEntityColisions(*context);
+			}
+
+			state.setItemsPerIteration(count);
+		});
+	}
+}
+
+static void registerEntityManagerCases(Bench::Runner& runner)
+{
+	// Server sized populations, every handle is spawned, given a component and despawned
+	for (size_t count : { 1000, 100000, 1000000 })
+	{
+		runner.add("entityManager/spawnDespawn/" + std::to_string(count), [count](Bench::State& state)
+		{
+			auto entities = std::make_unique<EntityManager>();
+			std::vector<Entity> handles(count);
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				for (Entity& handle : handles)
+				{
+					handle = entities->spawn();
+					entities->add<Comp::Collider>(handle, 0.3f);
+				}
+				for (Entity handle : handles)
+				{
+					entities->despawn(handle);
+				}
+				Bench::doNotOptimize(entities->size());
+			}
+
+			state.setItemsPerIteration(count);
+		});
+
+		// Same churn recorded from the job system and applied by one flush
+		runner.add("entityManager/deferredSpawnDespawn/" + std::to_string(count), [count](Bench::State& state)
+		{
+			auto entities = std::make_unique<EntityManager>();
+			constexpr size_t k_Grain = 4096;
+
+			for ([[maybe_unused]] auto _ : state)
+			{
+				Jobs::parallelFor(0, count, k_Grain, [&entities](size_t begin, size_t end)
+				{
+					auto& commands = entities->commands();
+					for (size_t i = begin; i < end; ++i)
+					{
+						commands.add<Comp::Collider>(commands.spawn(), 0.3f);
+					}
+				});
+				entities->flush();
+
+				const auto& colliders = entities->getSet<Comp::Collider>().indices();
+				Jobs::parallelFor(0, colliders.size(), k_Grain, [&entities, &colliders](size_t begin, size_t end)
+				{
+					auto& commands = entities->commands();
+					for (size_t i = begin; i < end; ++i)
+					{
+						commands.despawn(colliders[i]);
+					}
+				});
+				entities->flush();
+				Bench::doNotOptimize(entities->size());
+			}
+
+			state.setItemsPerIteration(count);
+		});
+	}
+}
+
+void Bench::registerEntityCases(Runner& runner)
+{
+	registerSparseSetCases(runner);
+	registerEntityManagerCases(runner);
+	registerSystemCases(runner);
+	registerCrowdCases(runner);
+	registerColliderSizeCases(runner);
+}
@@ -0,0 +1,65 @@
+#include <memory>
+#include <fstream>
+#include <numbers>
+#include "Bench.hpp"
+#include "Systems.hpp"
+#include "Renderer.hpp"
+#include "Window.hpp"
+
+struct ViewFixture
+{
+	std::string name;
+	std::shared_ptr<GameContext> context;
+	Entity viewer;
+};
+
+static ViewFixture makeView(std::string name, const nlohmann::json& mapping, Vec2 position)
+{
+	auto context = std::make_shared<GameContext>();
+	context->level.load(mapping);
+
+	Entity viewer = context->entities.spawn();
+	context->entities.add<Comp::Transform>(viewer, position);
+	return { std::move(name), context, viewer };
+}
+
+void Bench::registerRenderCases(Runner& runner)
+{
+	std::vector<ViewFixture> views;
+
+	{
+		// The test map is fogged
+		std::ifstream file("data/test_map.json");
+		nlohmann::json mapping;
+		file >> mapping;
+		views.push_back(makeView("corridor", mapping, Vec2(1.5f, 1.5f)));
+	}
+
+	{
+		// Generated maps have no fog, so every surface is lit at full visibility
+		auto mapping = Bench::generateOpenMap(256);
+		views.push_back(makeView("open", mapping, Vec2(mapping["spawnpoint"][0], mapping["spawnpoint"][1])));
+	}
+
+	for (const auto& view : views)
+	{
+		runner.add("render/software/" + view.name, [view](State& state)
+		{
+			Renderer::setRenderMode(Renderer::RenderMode::Software);
+
+			float angle = 0.0f;
+			for ([[maybe_unused]] auto _ : state)
+			{
+				view.context->entities.get<Comp::Transform>(view.viewer).angle = angle;
+
+				Renderer::beginDrawing();
+				Systems::displayView(*view.context, view.viewer);
+				Renderer::endDrawing();
+
+				angle += 0.7f;
+			}
+
+			state.setItemsPerIteration(Window::getWidth());
+		});
+	}
+}
@@ -0,0 +1,140 @@
+#include <memory>
+#include <fstream>
+#include <numbers>
+#include "Bench.hpp"
+#include "World.hpp"
+#include "Simd.hpp"
+
+nlohmann::json Bench::generateOpenMap(int32_t size)
+{
+	nlohmann::json mapping;
+
+	for (int32_t y = 0; y < size; ++y)
+	{
+		std::string row(size, ' ');
+
+		for (int32_t x = 0; x < size; ++x)
+		{
+			bool border = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+			bool pillar = x % 16 == 8 && y % 16 == 8;
+			if (border || pillar) row[x] = '#';
+		}
+
+		mapping["map"].push_back(row);
+	}
+
+	mapping["spawnpoint"] = { size / 2 + 0.5f, size / 2 + 0.5f };
+	return mapping;
+}
+
+struct MapFixture
+{
+	std::string name;
+	std::shared_ptr<World> world;
+	Vec2 origin;
+};
+
+static std::vector<MapFixture> loadMaps()
+{
+	std::vector<MapFixture> maps;
+
+	{
+		std::ifstream file("data/test_map.json");
+		nlohmann::json mapping;
+		file >> mapping;
+		Vec2 spawn(mapping["spawnpoint"][0], mapping["spawnpoint"][1]);
+		// The spawn sits in the maze entrance, one cell in keeps every direction inside the map
+		maps.push_back({ "corridor", std::make_shared<World>(mapping), spawn + Vec2(1.0f, 0.0f) });
+	}
+
+	{
+		auto mapping = Bench::generateOpenMap(256);
+		Vec2 spawn(mapping["spawnpoint"][0], mapping["spawnpoint"][1]);
+		maps.push_back({ "open", std::make_shared<World>(mapping), spawn });
+	}
+
+	return maps;
+}
+
+void Bench::registerWorldCases(Runner& runner)
+{
+	struct Direction
+	{
+		const char* name;
+		float angle;
+	};
+
+	static constexpr Direction k_Directions[] = {
+		{ "axis", 0.0f },
+		{ "diagonal", std::numbers::pi_v<float> / 4.0f },
+		{ "shallow", 0.1f },
+		{ "steep", std::numbers::pi_v<float> / 2.0f - 0.1f }
+	};
+
+	static constexpr size_t k_Columns = 1280;
+	static constexpr float k_ViewDistanceMargin = World::k_ViewDistance + 1.0f;
+	static constexpr float k_FieldOfView = std::numbers::pi_v<float> / 3.0f;
+
+	for (const auto& map : loadMaps())
+	{
+		for (const auto& direction : k_Directions)
+		{
+			runner.add("raycast/" + map.name + "/" + direction.name, [map, direction](State& state)
+			{
+				Vec2 ray = Vec2::direction(direction.angle);
+				for ([[maybe_unused]] auto _ : state)
+				{
+					doNotOptimize(map.world->raycast(map.origin, ray));
+				}
+			});
+		}
+
+		for (bool avx2 : { false, true })
+		{
+			if (avx2 && !Simd::detectAvx2()) continue;
+
+			runner.add("raycastColumns/" + map.name + (avx2 ? "/avx2" : "/scalar"), [map, avx2](State& state)
+			{
+				World::ColumnRays rays;
+				rays.build(k_Columns, k_FieldOfView);
+				World::RaycastColumns columns;
+				columns.resize(k_Columns);
+				Simd::setAvx2Enabled(avx2);
+
+				// Sweeps a full turn so every octant of the DDA is covered
+				float angle = 0.0f;
+				for ([[maybe_unused]] auto _ : state)
+				{
+					map.world->raycastColumns(map.origin, angle, rays, columns);
+					doNotOptimize(columns.distance.data());
+					angle += 0.7f;
+				}
+
+				state.setItemsPerIteration(k_Columns);
+				Simd::setAvx2Enabled(true);
+			});
+		}
+	}
+
+	// A camera crossing a map several times larger than the budget, so chunks
+	// entering the view get decoded and the ones behind it evicted
+	static constexpr int32_t k_StreamedMapSize = 2048;
+
+	auto streamed = std::make_shared<World>();
+	streamed->setStreamingSettings({ 1 << 20 });
+	streamed->load(generateOpenMap(k_StreamedMapSize));
+
+	runner.add("world/stream/2048", [streamed](State& state)
+	{
+		float x = k_ViewDistanceMargin;
+		for ([[maybe_unused]] auto _ : state)
+		{
+			const World::StreamFocus focus{ Vec2(x, k_StreamedMapSize / 2.0f), World::k_ViewDistance };
+			streamed->stream({ &focus, 1 });
+			doNotOptimize(streamed->residentBytes());
+
+			x += World::k_ChunkSize / 4.0f;
+			if (x > k_StreamedMapSize - k_ViewDistanceMargin) x = k_ViewDistanceMargin;
+		}
+	});
+}
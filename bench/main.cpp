@@ -0,0 +1,47 @@
+#include <cstdint>
+#include <fstream>
+#include "nlohmann/json.hpp"
+#include "Bench.hpp"
+#include "Renderer.hpp"
+#include "Window.hpp"
+#include "World.hpp"
+#include "Jobs.hpp"
+
+int32_t main(int32_t argc, char** argv)
+{
+	auto options = Bench::parseArguments(argc, argv);
+
+	// Tiles resolve their textures through the renderer, so it needs the same setup as the game
+	Jobs::init(options.workerCount);
+	Window::initHeadless(1280, 720);
+
+	using json = nlohmann::json;
+	{
+		std::ifstream file("assets/textures.json");
+		json mapping;
+		file >> mapping;
+		Renderer::loadImages(mapping);
+	}
+
+	while (!Renderer::loadTexturesFromImages())
+	{
+	}
+
+	{
+		std::ifstream file("data/tiles.json");
+		json mapping;
+		file >> mapping;
+		World::loadTiles(mapping);
+	}
+
+	Bench::Runner runner;
+	Bench::registerWorldCases(runner);
+	Bench::registerEntityCases(runner);
+	Bench::registerCollisionCases(runner);
+	Bench::registerRenderCases(runner);
+	runner.run(options);
+
+	Renderer::unload();
+	World::unloadTiles();
+	Jobs::shutdown();
+}
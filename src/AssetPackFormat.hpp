@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Layout of .opalpack files written by opal_packc. Everything is little endian.
+// Every texture is stored as RGBA8 pixels laid out like a raylib Image, level 0
+// first and then each smaller mipmap, so it can be uploaded straight from the file.
+namespace AssetPackFormat
+{
+	constexpr char k_Magic[8] = { 'O', 'P', 'A', 'L', 'P', 'A', 'K', '\0' };
+	constexpr uint32_t k_Version = 1;
+	constexpr size_t k_NameLength = 32;
+	constexpr size_t k_PixelsAlignment = 64;
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t entryCount;
+		uint64_t indexOffset;
+	};
+
+	struct Entry
+	{
+		char name[k_NameLength];
+		int32_t width;
+		int32_t height;
+		int32_t mipmaps;
+		uint32_t reserved;
+		uint64_t pixelsOffset;
+		uint64_t pixelsSize;
+	};
+
+	inline uint64_t pixelsSize(int32_t width, int32_t height, int32_t mipmaps)
+	{
+		uint64_t size = 0;
+		for (int32_t level = 0; level < mipmaps; ++level)
+		{
+			size += (uint64_t)(width > 1 ? width : 1) * (height > 1 ? height : 1) * 4;
+			width /= 2;
+			height /= 2;
+		}
+		return size;
+	}
+}
@@ -0,0 +1,170 @@
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include "Benchmark.hpp"
+#include "Renderer.hpp"
+#include "Window.hpp"
+#include "Memory.hpp"
+
+struct Keyframe
+{
+	float time;
+	Vec2 position;
+	float angle;
+};
+
+static std::vector<Keyframe> parseKeyframes(const nlohmann::json& path)
+{
+	std::vector<Keyframe> keyframes;
+
+	for (const auto& keyframe : path["keyframes"])
+	{
+		keyframes.push_back(Keyframe{
+			keyframe["time"].get<float>(),
+			Vec2(keyframe["position"][0].get<float>(), keyframe["position"][1].get<float>()),
+			keyframe["angle"].get<float>()
+		});
+	}
+
+	std::sort(keyframes.begin(), keyframes.end(), [](const Keyframe& a, const Keyframe& b)
+	{
+		return a.time < b.time;
+	});
+
+	return keyframes;
+}
+
+static Keyframe sampleKeyframes(const std::vector<Keyframe>& keyframes, float time)
+{
+	if (time <= keyframes.front().time) return keyframes.front();
+	if (time >= keyframes.back().time) return keyframes.back();
+
+	auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, [](float time, const Keyframe& keyframe)
+	{
+		return time < keyframe.time;
+	});
+	auto previous = next - 1;
+
+	float blend = (time - previous->time) / (next->time - previous->time);
+
+	return Keyframe{
+		time,
+		previous->position + (next->position - previous->position) * blend,
+		previous->angle + (next->angle - previous->angle) * blend
+	};
+}
+
+static float percentile(const std::vector<float>& sorted, float fraction)
+{
+	size_t rank = (size_t)std::ceil(fraction * sorted.size());
+	return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+std::optional<Benchmark::Report> Benchmark::runCameraPath(GameContext& context, Entity viewerId, const nlohmann::json& path)
+{
+	if (!path.contains("keyframes") || !path["keyframes"].is_array() || path["keyframes"].empty())
+	{
+		std::cerr << "Camera path has no keyframes" << std::endl;
+		return std::nullopt;
+	}
+
+	const auto keyframes = parseKeyframes(path);
+	const float frameRate = path.value("frameRate", 60.0f);
+	const size_t warmupFrames = path.value("warmupFrames", 10);
+	const size_t frames = (size_t)(keyframes.back().time * frameRate) + 1;
+
+	std::vector<float> frameTimes;
+	frameTimes.reserve(frames);
+	size_t raysCast = 0;
+	size_t drawCalls = 0;
+	size_t sprites = 0;
+	uint64_t allocations = 0;
+	double resolutionScales = 0.0;
+	double totalSeconds = 0.0;
+
+	for (size_t frame = 0; frame < warmupFrames + frames; ++frame)
+	{
+		if (Window::shouldClose()) break;
+
+		const bool measured = frame >= warmupFrames;
+		const float time = measured ? (frame - warmupFrames) / frameRate : 0.0f;
+		const Keyframe camera = sampleKeyframes(keyframes, time);
+
+		auto&& transform = context.entities.get<Comp::Transform>(viewerId);
+		transform.position = camera.position;
+		transform.angle = camera.angle;
+		Systems::streamWorld(context, viewerId);
+
+		auto start = std::chrono::steady_clock::now();
+
+		Renderer::beginDrawing();
+		Renderer::clearBackground();
+		Systems::displayView(context, viewerId);
+		Renderer::endDrawing();
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (!measured) continue;
+
+		frameTimes.push_back((float)(elapsed * 1000.0));
+		totalSeconds += elapsed;
+		raysCast += Renderer::getFrameStats().raysCast;
+		drawCalls += Renderer::getFrameStats().drawCalls;
+		sprites += Renderer::getFrameStats().spritesDrawn;
+		resolutionScales += Renderer::getFrameStats().resolutionScale;
+
+		for (size_t subsystem = 0; subsystem < (size_t)Memory::Subsystem::Count; ++subsystem)
+		{
+			allocations += Memory::lastFrame((Memory::Subsystem)subsystem).allocations;
+		}
+	}
+
+	Report report;
+	if (frameTimes.empty()) return report;
+
+	std::sort(frameTimes.begin(), frameTimes.end());
+	report.frames = frameTimes.size();
+	report.frameTimeP50 = percentile(frameTimes, 0.50f);
+	report.frameTimeP95 = percentile(frameTimes, 0.95f);
+	report.frameTimeP99 = percentile(frameTimes, 0.99f);
+	report.frameTimeMax = frameTimes.back();
+	report.raysPerSecond = raysCast / totalSeconds;
+	report.drawCallsPerFrame = (double)drawCalls / frameTimes.size();
+	report.spritesPerFrame = (double)sprites / frameTimes.size();
+	report.allocationsPerFrame = (double)allocations / frameTimes.size();
+	report.resolutionScale = (float)(resolutionScales / frameTimes.size());
+
+	return report;
+}
+
+nlohmann::json Benchmark::toJson(const Report& report)
+{
+	return nlohmann::json{
+		{ "frames", report.frames },
+		{ "frameTimeP50", report.frameTimeP50 },
+		{ "frameTimeP95", report.frameTimeP95 },
+		{ "frameTimeP99", report.frameTimeP99 },
+		{ "frameTimeMax", report.frameTimeMax },
+		{ "raysPerSecond", report.raysPerSecond },
+		{ "drawCallsPerFrame", report.drawCallsPerFrame },
+		{ "spritesPerFrame", report.spritesPerFrame },
+		{ "allocationsPerFrame", report.allocationsPerFrame },
+		{ "resolutionScale", report.resolutionScale }
+	};
+}
+
+void Benchmark::print(const Report& report)
+{
+	std::cout
+		<< "frames:              " << report.frames << "\n"
+		<< "frame time p50 (ms): " << report.frameTimeP50 << "\n"
+		<< "frame time p95 (ms): " << report.frameTimeP95 << "\n"
+		<< "frame time p99 (ms): " << report.frameTimeP99 << "\n"
+		<< "frame time max (ms): " << report.frameTimeMax << "\n"
+		<< "rays per second:     " << report.raysPerSecond << "\n"
+		<< "draw calls per frame:" << report.drawCallsPerFrame << "\n"
+		<< "sprites per frame:   " << report.spritesPerFrame << "\n"
+		<< "allocations per frame:" << report.allocationsPerFrame << "\n"
+		<< "resolution scale:    " << report.resolutionScale << std::endl;
+}
\ No newline at end of file
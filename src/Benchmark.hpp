@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include "nlohmann/json.hpp"
+#include "Systems.hpp"
+
+namespace Benchmark
+{
+	struct Report
+	{
+		size_t frames = 0;
+		float frameTimeP50 = 0.0f;
+		float frameTimeP95 = 0.0f;
+		float frameTimeP99 = 0.0f;
+		float frameTimeMax = 0.0f;
+		double raysPerSecond = 0.0;
+		double drawCallsPerFrame = 0.0;
+		double spritesPerFrame = 0.0;
+		// Global heap allocations, zero once every buffer reached its steady size
+		double allocationsPerFrame = 0.0;
+		// Below 1 when a frame time target made the view cast fewer rays than the window has columns
+		float resolutionScale = 1.0f;
+	};
+
+	// Moves the viewer along position and angle keyframes and times every rendered
+	// frame. Frame times in the report are in milliseconds. Empty when the path has no keyframes.
+	std::optional<Report> runCameraPath(GameContext& context, Entity viewerId, const nlohmann::json& path);
+	nlohmann::json toJson(const Report& report);
+	void print(const Report& report);
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <utility>
+#include "Entity.hpp"
+
+// Records structural changes so systems can request them while iterating,
+// possibly from several threads. EntityManager::flush applies them.
+template <typename ... Cs>
+class CommandBuffer
+{
+public:
+
+	// Entity spawned by this buffer, it gets a real handle at the flush
+	struct Spawned
+	{
+		uint32_t index;
+	};
+
+	Spawned spawn()
+	{
+		return { m_Spawns++ };
+	}
+
+	void despawn(Entity entity)
+	{
+		m_Despawns.push_back(entity);
+	}
+
+	// Adding a component the entity already has replaces it
+	template <typename C, typename ... Args>
+	void add(Entity entity, Args&&... args)
+	{
+		std::get<Queue<C>>(m_Queues).adds.emplace_back(entity, C(std::forward<Args>(args)...));
+	}
+
+	template <typename C, typename ... Args>
+	void add(Spawned spawned, Args&&... args)
+	{
+		std::get<Queue<C>>(m_Queues).spawnedAdds.emplace_back(spawned.index, C(std::forward<Args>(args)...));
+	}
+
+	template <typename C>
+	void remove(Entity entity)
+	{
+		std::get<Queue<C>>(m_Queues).removes.push_back(entity);
+	}
+
+	bool empty() const
+	{
+		return !m_Spawns && m_Despawns.empty() && std::apply([](const auto&... queues)
+		{
+			return (queues.empty() && ...);
+		}, m_Queues);
+	}
+
+	void clear()
+	{
+		m_Spawns = 0;
+		m_Despawns.clear();
+		std::apply([](auto&... queues) { (queues.clear(), ...); }, m_Queues);
+	}
+
+private:
+
+	friend class EntityManager;
+
+	template <typename C>
+	struct Queue
+	{
+		std::vector<std::pair<Entity, C>> adds;
+		std::vector<std::pair<uint32_t, C>> spawnedAdds;
+		std::vector<Entity> removes;
+
+		bool empty() const
+		{
+			return adds.empty() && spawnedAdds.empty() && removes.empty();
+		}
+
+		void clear()
+		{
+			adds.clear();
+			spawnedAdds.clear();
+			removes.clear();
+		}
+	};
+
+	std::tuple<Queue<Cs>...> m_Queues;
+	std::vector<Entity> m_Despawns;
+	uint32_t m_Spawns = 0;
+};
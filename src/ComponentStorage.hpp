@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Core.hpp"
+
+// Hands out memory aligned for full width vector loads
+template <typename T, size_t ALIGNMENT>
+struct AlignedAllocator
+{
+	using value_type = T;
+
+	template <typename U>
+	struct rebind { using other = AlignedAllocator<U, ALIGNMENT>; };
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, ALIGNMENT>&) {}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT)));
+	}
+
+	void deallocate(T* pointer, size_t)
+	{
+		::operator delete(pointer, std::align_val_t(ALIGNMENT));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, ALIGNMENT>&) const { return true; }
+};
+
+// Two float columns that read and write like a Vec2
+struct Vec2Ref
+{
+	float& x;
+	float& y;
+
+	operator Vec2() const { return Vec2(x, y); }
+
+	Vec2Ref& operator=(const Vec2& v)
+	{
+		x = v.x;
+		y = v.y;
+		return *this;
+	}
+
+	Vec2Ref& operator=(const Vec2Ref& v) { return *this = Vec2(v); }
+	Vec2Ref& operator+=(const Vec2& v) { return *this = Vec2(x + v.x, y + v.y); }
+	Vec2Ref& operator-=(const Vec2& v) { return *this = Vec2(x - v.x, y - v.y); }
+};
+
+// Components opt into structure-of-arrays storage by specializing this with
+// k_Columns, a Ref of float references assignable from the component and
+// convertible back to it, and ref() building one from the column pointers
+template <typename T>
+struct SoaLayout {};
+
+template <typename T>
+concept HasSoaLayout = requires { SoaLayout<T>::k_Columns; };
+
+// Plain array of structs, the default storage of a SparseSet
+template <typename T>
+class AosStorage
+{
+public:
+
+	using Reference = T&;
+	using ConstReference = const T&;
+
+	void reserve(size_t capacity) { m_Data.reserve(capacity); }
+	size_t size() const { return m_Data.size(); }
+	void clear() { m_Data.clear(); }
+
+	template <typename ... Args>
+	void emplaceBack(Args&&... args)
+	{
+		m_Data.emplace_back(std::forward<Args>(args)...);
+	}
+
+	void popBack() { m_Data.pop_back(); }
+	void swap(size_t first, size_t second) { std::swap(m_Data[first], m_Data[second]); }
+	void move(size_t from, size_t to) { m_Data[to] = std::move(m_Data[from]); }
+	void truncate(size_t size) { m_Data.erase(m_Data.begin() + size, m_Data.end()); }
+
+	Reference operator[](size_t index) { return m_Data[index]; }
+	ConstReference operator[](size_t index) const { return m_Data[index]; }
+
+	T* data() { return m_Data.data(); }
+
+private:
+
+	std::vector<T> m_Data;
+};
+
+// Every field in its own 32 byte aligned float array, so kernels load whole registers
+template <typename T>
+class SoaStorage
+{
+public:
+
+	using Layout = SoaLayout<T>;
+	using Reference = typename Layout::Ref;
+	using ConstReference = T;
+
+	static constexpr size_t k_Columns = Layout::k_Columns;
+	static constexpr size_t k_Alignment = 32;
+
+	// Column pointers of the whole storage, indexable like an array of components
+	class Columns
+	{
+	public:
+
+		explicit Columns(const std::array<float*, k_Columns>& columns) : m_Columns(columns) {}
+
+		float* column(size_t column) const { return m_Columns[column]; }
+		Reference operator[](size_t index) const { return Layout::ref(m_Columns.data(), index); }
+
+	private:
+
+		std::array<float*, k_Columns> m_Columns;
+	};
+
+	SoaStorage() = default;
+	SoaStorage(SoaStorage&&) = default;
+	SoaStorage& operator=(SoaStorage&&) = default;
+
+	SoaStorage(const SoaStorage& other) : m_Columns(other.m_Columns)
+	{
+		updatePointers();
+	}
+
+	SoaStorage& operator=(const SoaStorage& other)
+	{
+		m_Columns = other.m_Columns;
+		updatePointers();
+		return *this;
+	}
+
+	void reserve(size_t capacity)
+	{
+		for (auto& column : m_Columns) column.reserve(capacity);
+		updatePointers();
+	}
+
+	size_t size() const { return m_Columns[0].size(); }
+
+	void clear()
+	{
+		for (auto& column : m_Columns) column.clear();
+	}
+
+	template <typename ... Args>
+	void emplaceBack(Args&&... args)
+	{
+		for (auto& column : m_Columns) column.emplace_back();
+		updatePointers();
+		Layout::ref(m_Pointers.data(), size() - 1) = T(std::forward<Args>(args)...);
+	}
+
+	void popBack()
+	{
+		for (auto& column : m_Columns) column.pop_back();
+	}
+
+	void swap(size_t first, size_t second)
+	{
+		for (auto& column : m_Columns) std::swap(column[first], column[second]);
+	}
+
+	void move(size_t from, size_t to)
+	{
+		for (auto& column : m_Columns) column[to] = column[from];
+	}
+
+	void truncate(size_t size)
+	{
+		for (auto& column : m_Columns) column.resize(size);
+	}
+
+	Reference operator[](size_t index) { return Layout::ref(m_Pointers.data(), index); }
+	ConstReference operator[](size_t index) const { return Layout::ref(m_Pointers.data(), index); }
+
+	Columns data() { return Columns(m_Pointers); }
+
+private:
+
+	// Cached so building a reference costs no more than the loads it needs
+	void updatePointers()
+	{
+		for (size_t i = 0; i < k_Columns; ++i)
+		{
+			m_Pointers[i] = m_Columns[i].data();
+		}
+	}
+
+	std::array<std::vector<float, AlignedAllocator<float, k_Alignment>>, k_Columns> m_Columns;
+	std::array<float*, k_Columns> m_Pointers{};
+};
+
+template <typename T>
+using ComponentStorage = std::conditional_t<HasSoaLayout<T>, SoaStorage<T>, AosStorage<T>>;
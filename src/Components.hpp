@@ -3,6 +3,9 @@
 #include <algorithm>
 #include <numeric>
 #include "Core.hpp"
+#include "ComponentStorage.hpp"
+#include "Input.hpp"
+#include "Renderer.hpp"
 
 namespace Comp
 {
@@ -22,12 +25,15 @@ namespace Comp
 		float acceleration;
 		float deceleration;
 		Vec2 current;
+		// Where the entity wants to go, zero lets it slow down
+		Vec2 direction;
 
-		Velocity(float max, float acceleration, float deceleration, Vec2 starting = {}) :
+		Velocity(float max, float acceleration, float deceleration, Vec2 starting = {}, Vec2 direction = {}) :
 			max(max),
 			acceleration(acceleration),
 			deceleration(deceleration),
-			current(starting) {}
+			current(starting),
+			direction(direction) {}
 	};
 
 	struct Collider
@@ -38,5 +44,90 @@ namespace Comp
 			radius(radius) {}
 	};
 
-	struct Controlable {};
-}
\ No newline at end of file
+	struct Controlable
+	{
+		// What the controller asked for this tick
+		Input::Frame input;
+	};
+
+	// Drawn as a billboard standing on the floor at the entity's position
+	struct Sprite
+	{
+		TextureId texture;
+		// Height and width in cells
+		float size;
+
+		Sprite(TextureId texture, float size = 1.0f) :
+			texture(texture),
+			size(size) {}
+	};
+}
+
+// The movement systems run their kernels straight on these columns
+
+template <>
+struct SoaLayout<Comp::Transform>
+{
+	enum Column : size_t { Angle, PositionX, PositionY, k_Columns };
+
+	struct Ref
+	{
+		float& angle;
+		Vec2Ref position;
+
+		operator Comp::Transform() const { return Comp::Transform(position, angle); }
+
+		Ref& operator=(const Comp::Transform& transform)
+		{
+			angle = transform.angle;
+			position = transform.position;
+			return *this;
+		}
+	};
+
+	static Ref ref(float* const* columns, size_t index)
+	{
+		return { columns[Angle][index], { columns[PositionX][index], columns[PositionY][index] } };
+	}
+};
+
+template <>
+struct SoaLayout<Comp::Velocity>
+{
+	enum Column : size_t { Max, Acceleration, Deceleration, CurrentX, CurrentY, DirectionX, DirectionY, k_Columns };
+
+	struct Ref
+	{
+		float& max;
+		float& acceleration;
+		float& deceleration;
+		Vec2Ref current;
+		Vec2Ref direction;
+
+		operator Comp::Velocity() const
+		{
+			return Comp::Velocity(max, acceleration, deceleration, current, direction);
+		}
+
+		Ref& operator=(const Comp::Velocity& velocity)
+		{
+			max = velocity.max;
+			acceleration = velocity.acceleration;
+			deceleration = velocity.deceleration;
+			current = velocity.current;
+			direction = velocity.direction;
+			return *this;
+		}
+	};
+
+	static Ref ref(float* const* columns, size_t index)
+	{
+		return {
+			columns[Max][index],
+			columns[Acceleration][index],
+			columns[Deceleration][index],
+			{ columns[CurrentX][index], columns[CurrentY][index] },
+			{ columns[DirectionX][index], columns[DirectionY][index] }
+		};
+	}
+};
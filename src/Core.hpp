@@ -453,7 +453,7 @@ Vec2 Cir::resolve(const Cir& c) noexcept
 
 	if (distance == 0.0f)
 	{
-		return (radiusSum, 0.0f);
+		return Vec2(radiusSum, 0.0f);
 	}
 
 	Vec2 normal = difference / distance;
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// 32 bit entity handle. The low bits index the sparse arrays, the high bits
+// count how often that index was reused so stale handles stop matching.
+using Entity = uint32_t;
+
+namespace Handle
+{
+	constexpr uint32_t k_IndexBits = 22;
+	constexpr uint32_t k_IndexMask = (1u << k_IndexBits) - 1;
+	constexpr uint32_t k_GenerationMask = (1u << (32 - k_IndexBits)) - 1;
+
+	// The all ones index never names an entity, which keeps k_Null unambiguous
+	constexpr uint32_t k_MaxEntities = k_IndexMask;
+	constexpr Entity k_Null = 0xFFFFFFFF;
+
+	constexpr uint32_t index(Entity entity) { return entity & k_IndexMask; }
+	constexpr uint32_t generation(Entity entity) { return entity >> k_IndexBits; }
+
+	constexpr Entity make(uint32_t index, uint32_t generation)
+	{
+		return (generation & k_GenerationMask) << k_IndexBits | (index & k_IndexMask);
+	}
+}
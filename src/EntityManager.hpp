@@ -1,88 +1,319 @@
 #pragma once
 
 #include <vector>
-#include <unordered_set>
+#include <array>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+#include <limits>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include "Entity.hpp"
 #include "SparseSet.hpp"
+#include "CommandBuffer.hpp"
 #include "Components.hpp"
-
-static constexpr size_t k_MaxEntities = 2000;
-
-template <typename T>
-using CompSet = SparseSet<T, k_MaxEntities>;
-
-using CompSets = std::tuple<
-	CompSet<Comp::Collider>,
-	CompSet<Comp::Controlable>,
-	CompSet<Comp::Transform>,
-	CompSet<Comp::Velocity>
->;
+#include "Jobs.hpp"
+#include "Profiler.hpp"
+#include "Memory.hpp"
 
 class EntityManager
 {
 public:
 
-	static constexpr size_t k_MaxEntities = 2000;
+	template <typename T>
+	using CompSet = SparseSet<T, ComponentStorage<T>>;
+
+	// What get returns, T& or the field proxy of components stored as SoA
+	template <typename T>
+	using Reference = typename CompSet<T>::Reference;
 
+	// Dense storage of a set, a T* or the column pointers of components stored as SoA
 	template <typename T>
-	using CompSet = SparseSet<T, k_MaxEntities>;
+	using Array = decltype(std::declval<CompSet<T>&>().data());
 
-	using CompSets = std::tuple<
-		CompSet<Comp::Collider>,
-		CompSet<Comp::Controlable>,
-		CompSet<Comp::Transform>,
-		CompSet<Comp::Velocity>
+	// The sets and the command buffers are both built from this list
+	template <typename ... Cs>
+	struct ComponentList
+	{
+		using Sets = std::tuple<CompSet<Cs>...>;
+		using Commands = CommandBuffer<Cs...>;
+	};
+
+	using Components = ComponentList<
+		Comp::Collider,
+		Comp::Controlable,
+		Comp::Sprite,
+		Comp::Transform,
+		Comp::Velocity
 	>;
 
-	EntityManager()
+	using CompSets = Components::Sets;
+	using Commands = Components::Commands;
+
+	// An owning group keeps the first size entries of every owned set on the same
+	// entities in the same order. A set can be owned by a single group, and owned
+	// sets must only be modified through add and remove.
+	template <typename ... Owned>
+	struct GroupState
 	{
-		m_Freelist.reserve(k_MaxEntities);
-		for (int32_t id = k_MaxEntities - 1; id >= 0; --id)
+		size_t size = 0;
+	};
+
+	using Groups = std::tuple<
+		GroupState<Comp::Transform, Comp::Velocity>
+	>;
+
+	// Entities holding every one of Cs, found by walking the smallest of the sets.
+	// Components of that set come straight from its dense array.
+	template <typename ... Cs>
+	class View
+	{
+	public:
+
+		explicit View(CompSet<Cs>&... sets) : m_Sets(&sets...)
 		{
-			m_Freelist.push_back(id);
+			size_t index = 0;
+			size_t smallest = std::numeric_limits<size_t>::max();
+			((sets.size() < smallest ? (smallest = sets.size(), m_Driver = index) : 0, ++index), ...);
+
+			selectCandidates(std::index_sequence_for<Cs...>{});
+		}
+
+		// Upper bound of the matches, candidate ranges can be split across jobs
+		size_t candidates() const
+		{
+			return m_Candidates->size();
+		}
+
+		bool contains(Entity id) const
+		{
+			return (std::get<CompSet<Cs>*>(m_Sets)->contains(id) && ...);
+		}
+
+		template <typename F>
+		void each(size_t begin, size_t end, F&& function)
+		{
+			each(begin, end, function, std::index_sequence_for<Cs...>{});
+		}
+
+		template <typename F>
+		void each(F&& function)
+		{
+			each(0, candidates(), function);
+		}
+
+		class Iterator
+		{
+		public:
+
+			Iterator(View* view, size_t index) : m_Index(index), m_View(view)
+			{
+				skip();
+			}
+
+			std::tuple<Entity, Reference<Cs>...> operator*() const
+			{
+				return m_View->components(m_Index, std::index_sequence_for<Cs...>{});
+			}
+
+			Iterator& operator++()
+			{
+				++m_Index;
+				skip();
+				return *this;
+			}
+
+			bool operator!=(const Iterator& o) const
+			{
+				return m_Index != o.m_Index;
+			}
+
+		private:
+
+			void skip()
+			{
+				while (m_Index < m_View->candidates() && !m_View->matches(m_Index, std::index_sequence_for<Cs...>{}))
+				{
+					++m_Index;
+				}
+			}
+
+			size_t m_Index;
+			View* m_View;
+		};
+
+		Iterator begin()
+		{
+			return Iterator(this, 0);
+		}
+
+		Iterator end()
+		{
+			return Iterator(this, candidates());
+		}
+
+	private:
+
+		template <size_t ... Is>
+		void selectCandidates(std::index_sequence<Is...>)
+		{
+			((Is == m_Driver ? (m_Candidates = &std::get<Is>(m_Sets)->indices(), 0) : 0), ...);
+		}
+
+		// The driving set holds every candidate, only the others need a lookup
+		template <size_t ... Is>
+		bool matches(size_t candidate, std::index_sequence<Is...>) const
+		{
+			const Entity id = (*m_Candidates)[candidate];
+			return ((Is == m_Driver || std::get<Is>(m_Sets)->contains(id)) && ...);
+		}
+
+		template <size_t ... Is>
+		std::tuple<Entity, Reference<Cs>...> components(size_t candidate, std::index_sequence<Is...>) const
+		{
+			const Entity id = (*m_Candidates)[candidate];
+			return { id, (Is == m_Driver ? std::get<Is>(m_Sets)->data()[candidate] : (*std::get<Is>(m_Sets))[id])... };
+		}
+
+		// Resolving the driving set once keeps the per entity loop free of branches on it
+		template <typename F, size_t ... Is>
+		void each(size_t begin, size_t end, F& function, std::index_sequence<Is...> sequence)
+		{
+			((Is == m_Driver ? (eachDrivenBy<Is>(begin, end, function, sequence), 0) : 0), ...);
+		}
+
+		template <size_t D, typename F, size_t ... Is>
+		void eachDrivenBy(size_t begin, size_t end, F& function, std::index_sequence<Is...>)
+		{
+			auto& driver = *std::get<D>(m_Sets);
+			const Entity* ids = driver.indices().data();
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				const Entity id = ids[i];
+				if (!((Is == D || std::get<Is>(m_Sets)->contains(id)) && ...)) continue;
+
+				function(id, component<Is, D>(i, id)...);
+			}
+		}
+
+		template <size_t I, size_t D>
+		decltype(auto) component(size_t denseIndex, Entity id)
+		{
+			if constexpr (I == D) return std::get<I>(m_Sets)->data()[denseIndex];
+			else return (*std::get<I>(m_Sets))[id];
+		}
+
+		std::tuple<CompSet<Cs>*...> m_Sets;
+		const std::vector<Entity>* m_Candidates = nullptr;
+		size_t m_Driver = 0;
+	};
+
+	// Matching entities of an owning group as parallel arrays, no lookups needed
+	template <typename ... Cs>
+	class Group
+	{
+	public:
+
+		Group(size_t size, CompSet<Cs>&... sets) :
+			m_Size(size),
+			m_Entities(std::get<0>(std::forward_as_tuple(sets...)).indices().data()),
+			m_Arrays(sets.data()...) {}
+
+		size_t size() const
+		{
+			return m_Size;
+		}
+
+		const Entity* entities() const
+		{
+			return m_Entities;
+		}
+
+		template <typename C>
+		Array<C> data() const
+		{
+			return std::get<Array<C>>(m_Arrays);
+		}
+
+		template <typename F>
+		void each(size_t begin, size_t end, F&& function)
+		{
+			for (size_t i = begin; i < end; ++i)
+			{
+				function(m_Entities[i], std::get<Array<Cs>>(m_Arrays)[i]...);
+			}
 		}
-	}
 
-	size_t spawn()
+		template <typename F>
+		void each(F&& function)
+		{
+			each(0, m_Size, function);
+		}
+
+	private:
+
+		size_t m_Size;
+		const Entity* m_Entities;
+		std::tuple<Array<Cs>...> m_Arrays;
+	};
+
+	Entity spawn()
 	{
-		size_t id = m_Freelist.back();
+		if (m_Freelist.empty())
+		{
+			assert(m_Slots.size() < Handle::k_MaxEntities);
+
+			m_Slots.push_back(Handle::make((uint32_t)m_Slots.size(), 0));
+			return m_Slots.back();
+		}
+
+		const uint32_t index = m_Freelist.back();
 		m_Freelist.pop_back();
-		m_Entities.insert(id);
-		return id;
+
+		m_Slots[index] = Handle::make(index, Handle::generation(m_Slots[index]));
+		return m_Slots[index];
 	}
 
-	void despawn(size_t id)
+	void despawn(Entity id)
 	{
-		if (!m_Entities.count(id)) return;
+		if (!contains(id)) return;
 
-		std::get<CompSet<Comp::Collider>>(m_Components).popIfContains(id);
-		std::get<CompSet<Comp::Controlable>>(m_Components).popIfContains(id);
-		std::get<CompSet<Comp::Transform>>(m_Components).popIfContains(id);
-		std::get<CompSet<Comp::Velocity>>(m_Components).popIfContains(id);
+		forEachSet([&](auto& set) { remove<typename std::decay_t<decltype(set)>::Value>(id); });
+		release(id);
+	}
 
-		m_Freelist.push_back(id);
+	// Entities currently alive
+	size_t size() const
+	{
+		return m_Slots.size() - m_Freelist.size();
 	}
 
 	template <typename C, typename ... Args>
-	void add(size_t id, Args&&... args)
+	void add(Entity id, Args&&... args)
 	{
 		std::get<CompSet<C>>(m_Components).emplace(id, std::forward<Args>(args)...);
+		std::apply([&](auto&... groups) { (enterGroup<C>(groups, id), ...); }, m_Groups);
 	}
 
 	template <typename C>
-	void remove(size_t id)
+	void remove(Entity id)
 	{
-		std::get<CompSet<C>>(m_Components).popIfContains(id);
+		if (!has<C>(id)) return;
+
+		std::apply([&](auto&... groups) { (leaveGroup<C>(groups, id), ...); }, m_Groups);
+		std::get<CompSet<C>>(m_Components).pop(id);
 	}
 
 	template <typename C>
-	bool has(size_t id)
+	bool has(Entity id)
 	{
 		return std::get<CompSet<C>>(m_Components).contains(id);
 	}
 
 	template <typename C>
-	C& get(size_t id)
+	Reference<C> get(Entity id)
 	{
 		return std::get<CompSet<C>>(m_Components)[id];
 	}
@@ -93,16 +324,246 @@ public:
 		return std::get<CompSet<C>>(m_Components);
 	}
 
-	bool contains(size_t id)
+	template <typename ... Cs>
+	View<Cs...> view()
+	{
+		return View<Cs...>(getSet<Cs>()...);
+	}
+
+	// Only the exact owned type lists declared in Groups are valid here
+	template <typename ... Cs>
+	Group<Cs...> group()
+	{
+		return Group<Cs...>(std::get<GroupState<Cs...>>(m_Groups).size, getSet<Cs>()...);
+	}
+
+	// False for handles whose entity was despawned, even once the index is reused
+	bool contains(Entity id) const
+	{
+		const uint32_t index = Handle::index(id);
+		return index < m_Slots.size() && m_Slots[index] == id;
+	}
+
+	// Buffer of the calling thread. Systems record structural changes here while
+	// iterating, nothing moves until the next flush.
+	Commands& commands()
 	{
-		assert(id < k_MaxEntities, "You're trying to check if an entity of impossible id exists");
+		return m_Commands[Jobs::threadIndex()];
+	}
+
+	// Applies every recorded command at a sync point, once no system iterates.
+	// Removes and despawns go first, then spawns and adds, each in one bulk pass
+	// per component type over the entities sorted by index.
+	void flush()
+	{
+		OPAL_PROFILE_SCOPE("EntityManager::flush");
+		Memory::Tag tag(Memory::Subsystem::Entities);
+
+		std::vector<Entity> despawns;
+		for (auto& commands : m_Commands)
+		{
+			despawns.insert(despawns.end(), commands.m_Despawns.begin(), commands.m_Despawns.end());
+		}
+
+		// Once the stale handles are gone, equal indices mean equal handles
+		std::erase_if(despawns, [this](Entity entity) { return !contains(entity); });
+		sortByIndex(despawns, [](Entity entity) { return entity; });
+		despawns.erase(std::unique(despawns.begin(), despawns.end()), despawns.end());
+
+		forEachSet([&](auto& set) { flushRemoves(set, despawns); });
+
+		// Reversed, so the freelist hands the indices back in ascending order
+		for (auto it = despawns.rbegin(); it != despawns.rend(); ++it)
+		{
+			release(*it);
+		}
+
+		// Handles of the entities spawned by each buffer, in buffer order
+		std::vector<Entity> spawned;
+		std::array<size_t, Jobs::k_MaxWorkers + 1> firstSpawned;
+
+		for (size_t i = 0; i < m_Commands.size(); ++i)
+		{
+			firstSpawned[i] = spawned.size();
+			for (uint32_t n = 0; n < m_Commands[i].m_Spawns; ++n)
+			{
+				spawned.push_back(spawn());
+			}
+		}
+
+		forEachSet([&](auto& set) { flushAdds(set, spawned, firstSpawned); });
 
-		return m_Entities.count(id);
+		for (auto& commands : m_Commands)
+		{
+			commands.clear();
+		}
 	}
 
 private:
 
-	std::vector<size_t> m_Freelist;
-	std::unordered_set<size_t> m_Entities;
+	template <typename F>
+	void forEachSet(F&& function)
+	{
+		std::apply([&](auto&... sets) { (function(sets), ...); }, m_Components);
+	}
+
+	// Index order keeps the sparse pages and dense arrays walked front to back.
+	// Stable radix sort over the index bits, two passes whatever the count.
+	template <typename T, typename Key>
+	static void sortByIndex(std::vector<T>& items, Key&& key)
+	{
+		constexpr uint32_t k_DigitBits = (Handle::k_IndexBits + 1) / 2;
+		constexpr uint32_t k_Buckets = 1u << k_DigitBits;
+
+		const auto digit = [&](const T& item, uint32_t shift)
+		{
+			return (Handle::index(key(item)) >> shift) & (k_Buckets - 1);
+		};
+
+		const auto less = [&](const T& a, const T& b) { return Handle::index(key(a)) < Handle::index(key(b)); };
+		if (std::is_sorted(items.begin(), items.end(), less)) return;
+
+		std::vector<uint32_t> order(items.size());
+		std::vector<uint32_t> scratch(items.size());
+		std::iota(order.begin(), order.end(), 0u);
+
+		for (uint32_t shift = 0; shift < Handle::k_IndexBits; shift += k_DigitBits)
+		{
+			std::vector<uint32_t> offsets(k_Buckets + 1);
+			for (const T& item : items) ++offsets[digit(item, shift) + 1];
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			for (uint32_t i : order) scratch[offsets[digit(items[i], shift)]++] = i;
+			order.swap(scratch);
+		}
+
+		std::vector<T> sorted;
+		sorted.reserve(items.size());
+		for (uint32_t i : order) sorted.push_back(std::move(items[i]));
+		items.swap(sorted);
+	}
+
+	template <typename Set>
+	void flushRemoves(Set& set, const std::vector<Entity>& despawns)
+	{
+		using C = typename Set::Value;
+
+		std::vector<Entity> removes;
+		for (auto& commands : m_Commands)
+		{
+			const auto& queued = std::get<typename Commands::template Queue<C>>(commands.m_Queues).removes;
+			std::copy_if(queued.begin(), queued.end(), std::back_inserter(removes), [&set](Entity entity)
+			{
+				return set.contains(entity);
+			});
+		}
+
+		// The despawns are already sorted, only mixing in queued removes needs another sort
+		const bool sorted = removes.empty();
+		std::copy_if(despawns.begin(), despawns.end(), std::back_inserter(removes), [&set](Entity entity)
+		{
+			return set.contains(entity);
+		});
+
+		if (removes.empty()) return;
+
+		if (!sorted)
+		{
+			sortByIndex(removes, [](Entity entity) { return entity; });
+			removes.erase(std::unique(removes.begin(), removes.end()), removes.end());
+		}
+
+		// Leaving a group only swaps within its packed front, the rest goes in one pass
+		for (Entity entity : removes)
+		{
+			std::apply([&](auto&... groups) { (leaveGroup<C>(groups, entity), ...); }, m_Groups);
+		}
+
+		set.eraseBulk(removes);
+	}
+
+	template <typename Set>
+	void flushAdds(Set& set, const std::vector<Entity>& spawned, const std::array<size_t, Jobs::k_MaxWorkers + 1>& firstSpawned)
+	{
+		using C = typename Set::Value;
+
+		std::vector<std::pair<Entity, C>> adds;
+		for (size_t i = 0; i < m_Commands.size(); ++i)
+		{
+			auto& queue = std::get<typename Commands::template Queue<C>>(m_Commands[i].m_Queues);
+
+			for (auto& add : queue.adds)
+			{
+				if (contains(add.first)) adds.push_back(std::move(add));
+			}
+			for (auto& [local, item] : queue.spawnedAdds)
+			{
+				adds.emplace_back(spawned[firstSpawned[i] + local], std::move(item));
+			}
+		}
+
+		if (adds.empty()) return;
+
+		// Stable, so the adds of one entity stay in recording order and the last one wins
+		sortByIndex(adds, [](const auto& add) { return add.first; });
+
+		std::vector<std::pair<Entity, C>> inserts;
+		for (size_t i = 0; i < adds.size(); ++i)
+		{
+			auto& [entity, item] = adds[i];
+			if (i + 1 < adds.size() && adds[i + 1].first == entity) continue;
+
+			if (set.contains(entity)) set[entity] = std::move(item);
+			else inserts.push_back(std::move(adds[i]));
+		}
+
+		set.insertBulk(inserts);
+
+		for (const auto& [entity, _] : inserts)
+		{
+			std::apply([&](auto&... groups) { (enterGroup<C>(groups, entity), ...); }, m_Groups);
+		}
+	}
+
+	// A free slot keeps the next generation behind an index no handle can have
+	void release(Entity id)
+	{
+		const uint32_t index = Handle::index(id);
+		m_Slots[index] = Handle::make(Handle::k_IndexMask, Handle::generation(id) + 1);
+		m_Freelist.push_back(index);
+	}
+
+	// Moves an entity that just completed the owned set into the packed front of every owned array
+	template <typename C, typename ... Owned>
+	void enterGroup(GroupState<Owned...>& group, Entity id)
+	{
+		if constexpr ((std::is_same_v<C, Owned> || ...))
+		{
+			if (!(has<Owned>(id) && ...)) return;
+
+			(getSet<Owned>().swapDense(getSet<Owned>().denseIndex(id), group.size), ...);
+			++group.size;
+		}
+	}
+
+	// Swaps the entity to the group's last slot and shrinks the group, before C gets popped
+	template <typename C, typename ... Owned>
+	void leaveGroup(GroupState<Owned...>& group, Entity id)
+	{
+		if constexpr ((std::is_same_v<C, Owned> || ...))
+		{
+			if (!(has<Owned>(id) && ...)) return;
+
+			assert(getSet<C>().denseIndex(id) < group.size);
+			--group.size;
+			(getSet<Owned>().swapDense(getSet<Owned>().denseIndex(id), group.size), ...);
+		}
+	}
+
+	// Current handle of every index ever handed out, and the indices free for reuse
+	std::vector<Entity> m_Slots;
+	std::vector<uint32_t> m_Freelist;
 	CompSets m_Components;
+	Groups m_Groups;
+	std::array<Commands, Jobs::k_MaxWorkers + 1> m_Commands;
 };
\ No newline at end of file
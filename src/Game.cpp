@@ -1,6 +1,10 @@
 #include <cstdint>
 #include <fstream>
 #include <chrono>
+#include <cmath>
+#include <string_view>
+#include <filesystem>
+#include <random>
 #include "nlohmann/json.hpp"
 #include "Game.hpp"
 #include "Renderer.hpp"
@@ -9,26 +13,163 @@
 #include "World.hpp"
 #include "EntityManager.hpp"
 #include "Systems.hpp"
+#include "Jobs.hpp"
+#include "Benchmark.hpp"
+#include "Input.hpp"
+#include "Profiler.hpp"
+#include "Memory.hpp"
 
 #include "raylib.h"
 
 static GameContext s_Context;
+static Game::Settings s_Settings;
 
-static size_t s_PlayerId;
+static Entity s_PlayerId;
+static Input::Recorder s_Recorder;
+static Input::Replay s_Replay;
+// Input of the tick about to run and, when replaying, the hash it has to end in
+static Input::Frames s_Frames;
+static uint64_t s_ReplayHash = 0;
+// 1 based so 0 means the replay never diverged
+static size_t s_ReplayDivergedAt = 0;
+static bool s_ShowProfiler = false;
 static void spawnPlayer(Vec2 position);
+static void spawnSprites(size_t count);
+static bool loadLevel(const std::string& path);
 static void displayPlayerAttributes(GameContext& context);
 
-void Game::init()
+Game::Settings Game::parseArguments(int32_t argc, char** argv)
 {
-	using json = nlohmann::json;
+	Settings settings;
+
+	for (int32_t i = 1; i < argc; ++i)
+	{
+		std::string_view argument = argv[i];
+
+		if (argument == "--software")
+		{
+			settings.renderMode = Renderer::RenderMode::Software;
+		}
+		else if (argument == "--no-floor-casting")
+		{
+			settings.floorCasting = false;
+		}
+		else if (argument == "--workers" && i + 1 < argc)
+		{
+			settings.workerCount = std::stoul(argv[++i]);
+		}
+		else if (argument == "--headless")
+		{
+			settings.headless = true;
+		}
+		else if (argument == "--no-vsync")
+		{
+			settings.vsync = false;
+		}
+		else if (argument == "--tick-rate" && i + 1 < argc)
+		{
+			settings.tickRate = std::max(std::stoi(argv[++i]), 1);
+		}
+		else if (argument == "--max-ticks" && i + 1 < argc)
+		{
+			settings.maxTicksPerFrame = std::max(std::stoi(argv[++i]), 1);
+		}
+		else if (argument == "--resolution" && i + 1 < argc)
+		{
+			std::string resolution = argv[++i];
+			size_t separator = resolution.find('x');
+			settings.width = std::stoi(resolution.substr(0, separator));
+			settings.height = std::stoi(resolution.substr(separator + 1));
+		}
+		else if (argument == "--resolution-scale" && i + 1 < argc)
+		{
+			settings.resolutionScale = std::stof(argv[++i]);
+		}
+		else if (argument == "--target-frame-time" && i + 1 < argc)
+		{
+			settings.targetFrameTime = std::stof(argv[++i]);
+		}
+		else if (argument == "--camera-path" && i + 1 < argc)
+		{
+			settings.cameraPath = argv[++i];
+		}
+		else if (argument == "--benchmark-output" && i + 1 < argc)
+		{
+			settings.benchmarkOutput = argv[++i];
+		}
+		else if (argument == "--capture" && i + 1 < argc)
+		{
+			settings.capturePath = argv[++i];
+		}
+		else if (argument == "--record" && i + 1 < argc)
+		{
+			settings.recordPath = argv[++i];
+		}
+		else if (argument == "--replay" && i + 1 < argc)
+		{
+			settings.replayPath = argv[++i];
+		}
+		else if (argument == "--strict-allocations")
+		{
+			settings.strictAllocations = true;
+		}
+		else if (argument == "--trace" && i + 1 < argc)
+		{
+			settings.tracePath = argv[++i];
+		}
+		else if (argument == "--asset-pack" && i + 1 < argc)
+		{
+			settings.assetPackPath = argv[++i];
+		}
+		else if (argument == "--map" && i + 1 < argc)
+		{
+			settings.mapPath = argv[++i];
+		}
+		else if (argument == "--sprites" && i + 1 < argc)
+		{
+			settings.spriteCount = std::stoul(argv[++i]);
+		}
+		else if (argument == "--world-budget" && i + 1 < argc)
+		{
+			settings.worldMemoryBudget = std::stoull(argv[++i]) << 20;
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << argument << std::endl;
+		}
+	}
+
+	// Without a window nothing could ever end the game loop
+	if (settings.headless && settings.cameraPath.empty() && settings.replayPath.empty())
+	{
+		settings.cameraPath = "data/camera_path.json";
+	}
+
+	return settings;
+}
+
+void Game::init(const Settings& settings)
+{
+	s_Settings = settings;
+	Renderer::setRenderMode(settings.headless ? Renderer::RenderMode::Software : settings.renderMode);
+	Renderer::setResolutionScale(settings.resolutionScale);
+	Renderer::setFloorCasting(settings.floorCasting);
+	Renderer::setTargetFrameTime(settings.targetFrameTime / 1000.0f);
+	Jobs::init(settings.workerCount);
+	if (!settings.tracePath.empty()) Profiler::setEnabled(true);
+	Memory::setStrictFrames(settings.strictAllocations);
+
+	// Like maps, the packed textures only exist after a build, decoding the pngs always works
+	if (!Renderer::loadAssetPack(settings.assetPackPath))
 	{
 		std::ifstream file("assets/textures.json");
-		json mapping;
+		nlohmann::json mapping;
 		file >> mapping;
 		Renderer::loadImages(mapping);
 	}
 
-	Window::init(1280, 720, "Opal Engine");
+	if (settings.headless) Window::initHeadless(settings.width, settings.height);
+	else Window::init(settings.width, settings.height, "Opal Engine", settings.vsync);
 
 	while (!Renderer::loadTexturesFromImages());
 	using json = nlohmann::json;
@@ -37,38 +178,120 @@ void Game::init()
 		json mapping;
 		file >> mapping;
 		World::loadTiles(mapping);
-		file.close();
+	}
 
-		file.clear();
-		file.open("data/test_map.json");
-		file >> mapping;
-		s_Context.level.load(mapping);
-		spawnPlayer(Vec2(mapping["spawnpoint"][0],mapping["spawnpoint"][1]));
+	// A replay only matches when it runs on the world it was recorded on
+	if (!settings.replayPath.empty() && s_Replay.open(settings.replayPath))
+	{
+		s_Settings.tickRate = (int32_t)s_Replay.session().tickRate;
+		s_Settings.worldMemoryBudget = s_Replay.session().worldMemoryBudget;
+		s_Settings.mapPath = s_Replay.session().mapPath;
+		s_Settings.spriteCount = s_Replay.session().spriteCount;
+	}
+
+	if (!settings.recordPath.empty())
+	{
+		s_Recorder.open(settings.recordPath, { (uint32_t)s_Settings.tickRate, s_Settings.worldMemoryBudget, s_Settings.mapPath, (uint32_t)s_Settings.spriteCount });
+	}
+
+	s_Context.level.setStreamingSettings({ s_Settings.worldMemoryBudget });
+
+	// The compiled map only exists once opal_mapc ran, the json one is always there
+	if (!loadLevel(s_Settings.mapPath))
+	{
+		std::filesystem::path authoringMap = s_Settings.mapPath;
+		authoringMap.replace_extension(".json");
+		if (authoringMap != s_Settings.mapPath) loadLevel(authoringMap.string());
 	}
-	DisableCursor();
+
+	spawnPlayer(s_Context.level.spawnpoint());
+	spawnSprites(s_Settings.spriteCount);
+
+	if (!settings.headless) DisableCursor();
 }
 
 void Game::cleanup()
 {
+	if (!s_Settings.tracePath.empty()) Profiler::exportChromeTrace(s_Settings.tracePath);
+
 	Renderer::unload();
 	Window::close();
 	World::unloadTiles();
+	Jobs::shutdown();
 }
 
 static void tick(float dt);
+static void checkReplayTick();
+static void reportReplay(float seconds);
+static void runBenchmark();
+static void runReplay();
 
 void Game::loop()
 {
+	if (!s_Settings.cameraPath.empty())
+	{
+		runBenchmark();
+		return;
+	}
+
+	if (Window::isHeadless())
+	{
+		runReplay();
+		return;
+	}
+
+	const float step = 1.0f / (float)s_Settings.tickRate;
 	SecClock clock;
+	float accumulator = 0.0f;
+	SecClock replayClock;
 
 	while (!Window::shouldClose())
 	{
-		tick(clock.restart());
+		if (IsKeyPressed(KEY_F2))
+		{
+			Renderer::setRenderMode(
+				Renderer::getRenderMode() == Renderer::RenderMode::Gpu ?
+				Renderer::RenderMode::Software : Renderer::RenderMode::Gpu
+			);
+		}
+
+		if (IsKeyPressed(KEY_F3))
+		{
+			s_ShowProfiler = !s_ShowProfiler;
+			// A trace keeps recording while the overlay is hidden
+			Profiler::setEnabled(s_ShowProfiler || !s_Settings.tracePath.empty());
+		}
+
+		const float frameTime = clock.restart();
+		accumulator += frameTime;
+		Profiler::endFrame(frameTime);
+		Input::pollDevice();
+
+		int32_t ticks = 0;
+		while (accumulator >= step && ticks < s_Settings.maxTicksPerFrame)
+		{
+			// A replay drives the ticks it recorded, the devices take over once it ends
+			const bool replaying = s_Replay.isOpen();
+			if (replaying && !s_Replay.next(s_Frames, s_ReplayHash)) reportReplay(replayClock.elapsed());
+			if (!s_Replay.isOpen()) s_Frames.assign(1, { s_PlayerId, Input::takeDeviceFrame() });
+
+			Systems::snapshotTransforms(s_Context);
+			tick(step);
+			if (s_Replay.isOpen()) checkReplayTick();
+
+			accumulator -= step;
+			++ticks;
+		}
+
+		// Time the catch-up limit could not simulate is dropped, keeping only the phase
+		if (accumulator >= step) accumulator = std::fmod(accumulator, step);
+		s_Context.interpolation = accumulator / step;
 
 		Renderer::beginDrawing();
 		Renderer::clearBackground();
 
 		Systems::displayView(s_Context, s_PlayerId);
+		if (s_ShowProfiler) Renderer::drawProfilerOverlay();
 
 		Renderer::endDrawing();
 	}
@@ -76,9 +299,119 @@ void Game::loop()
 
 void tick(float dt)
 {
+	OPAL_PROFILE_SCOPE("Game::tick");
+	Memory::Tag tag(Memory::Subsystem::Simulation);
+
+	Systems::applyInput(s_Context, s_Frames);
 	Systems::moveControlable(s_Context, dt);
-	Systems::applyVelocity(s_Context, dt);
+	Systems::accelerate(s_Context, dt);
+	Systems::moveAndSlide(s_Context, dt);
+	Systems::resolveEntityColisions(s_Context);
 	Systems::resolveWorldColisions(s_Context);
+	Systems::streamWorld(s_Context, s_PlayerId);
+
+	// Structural changes recorded by the systems above land here, between frames
+	s_Context.entities.flush();
+
+	if (s_Recorder.isOpen()) s_Recorder.write(s_Frames, Systems::hashTransforms(s_Context));
+}
+
+void checkReplayTick()
+{
+	if (s_ReplayDivergedAt || Systems::hashTransforms(s_Context) == s_ReplayHash) return;
+
+	s_ReplayDivergedAt = s_Replay.tick();
+	std::cerr << "Replay diverged from the recording at tick " << s_ReplayDivergedAt << std::endl;
+}
+
+void reportReplay(float seconds)
+{
+	const size_t ticks = s_Replay.tick();
+	const float tickTime = ticks ? seconds * 1000.0f / (float)ticks : 0.0f;
+
+	std::cout
+		<< "ticks:              " << ticks << "\n"
+		<< "tick time (ms):     " << tickTime << "\n"
+		<< "matches recording:  " << (s_ReplayDivergedAt ? "no" : "yes") << std::endl;
+
+	if (!s_Settings.benchmarkOutput.empty())
+	{
+		std::ofstream output(s_Settings.benchmarkOutput);
+		output << nlohmann::json{
+			{ "ticks", ticks },
+			{ "tickTime", tickTime },
+			{ "divergedAt", s_ReplayDivergedAt }
+		}.dump(4);
+	}
+}
+
+void runReplay()
+{
+	if (!s_Replay.isOpen())
+	{
+		std::cerr << "Nothing to run headless without a camera path or a replay" << std::endl;
+		return;
+	}
+
+	const float step = 1.0f / (float)s_Settings.tickRate;
+	SecClock clock;
+
+	while (s_Replay.next(s_Frames, s_ReplayHash))
+	{
+		tick(step);
+		checkReplayTick();
+
+		// Nothing renders, so every tick closes a frame
+		Memory::endFrame();
+	}
+
+	reportReplay(clock.elapsed());
+}
+
+void runBenchmark()
+{
+	std::ifstream file(s_Settings.cameraPath);
+	if (!file)
+	{
+		std::cerr << "Could not open camera path " << s_Settings.cameraPath << std::endl;
+		return;
+	}
+
+	nlohmann::json path;
+	file >> path;
+
+	auto report = Benchmark::runCameraPath(s_Context, s_PlayerId, path);
+	if (!report) return;
+
+	Benchmark::print(*report);
+
+	if (!s_Settings.benchmarkOutput.empty())
+	{
+		std::ofstream output(s_Settings.benchmarkOutput);
+		output << Benchmark::toJson(*report).dump(4);
+	}
+
+	if (!s_Settings.capturePath.empty())
+	{
+		Renderer::exportFramebuffer(s_Settings.capturePath);
+	}
+}
+
+bool loadLevel(const std::string& path)
+{
+	if (path.ends_with(".opalmap")) return s_Context.level.loadBinary(path);
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Could not open map " << path << std::endl;
+		return false;
+	}
+
+	nlohmann::json mapping;
+	file >> mapping;
+	s_Context.level.load(mapping);
+	return true;
 }
 
 void spawnPlayer(Vec2 position)
@@ -92,13 +425,39 @@ void spawnPlayer(Vec2 position)
 	entities.add<Comp::Collider>(s_PlayerId, 0.3f);
 }
 
+// Fixed seed, so benchmark runs and replays see the same sprites
+void spawnSprites(size_t count)
+{
+	const World& level = s_Context.level;
+	if (!count || level.width() <= 0 || level.height() <= 0) return;
+
+	auto& entities = s_Context.entities;
+	const TextureId texture = Renderer::getNumericalId("orb_sprite");
+	// The engine's output is specified exactly, the standard distributions are not
+	std::mt19937 random(1);
+	const auto coordinate = [&random](int32_t size) { return (float)(random() % ((uint32_t)size << 8)) / 256.0f; };
+
+	// Bounded, a map without open cells must not hang here
+	const size_t attempts = count * 16;
+	for (size_t attempt = 0; attempt < attempts && count; ++attempt)
+	{
+		const Vec2 position(coordinate(level.width()), coordinate(level.height()));
+		if (level.isSolid(static_cast<Vec2i>(position))) continue;
+
+		const Entity sprite = entities.spawn();
+		entities.add<Comp::Transform>(sprite, position);
+		entities.add<Comp::Sprite>(sprite, texture, 0.6f);
+		--count;
+	}
+}
+
 static void displayPlayerAttributes(GameContext& context)
 {
 	auto& entities = s_Context.entities;
 	auto id = s_PlayerId;
 
-	auto transform = entities.get<Comp::Transform>(id);
-	auto velocity = entities.get<Comp::Velocity>(id);
+	Comp::Transform transform = entities.get<Comp::Transform>(id);
+	Comp::Velocity velocity = entities.get<Comp::Velocity>(id);
 
 	std::cout << transform.position << " " << transform.angle << " " << velocity.current << std::endl;
 }
\ No newline at end of file
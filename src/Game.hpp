@@ -1,8 +1,58 @@
 #pragma once
 
+#include <cstdint>
+#include <thread>
+#include <algorithm>
+#include <string>
+#include "Renderer.hpp"
+#include "World.hpp"
+
 namespace Game
 {
-	void init();
+	struct Settings
+	{
+		Renderer::RenderMode renderMode = Renderer::RenderMode::Gpu;
+		// Flat floors and ceilings when off, the GPU mode then renders without a CPU pass
+		bool floorCasting = true;
+		// 0 runs every job on the main thread
+		size_t workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+		bool headless = false;
+		// Frames are presented as fast as they render when off
+		bool vsync = true;
+		// The simulation always advances by 1 / tickRate seconds, rendering blends between ticks
+		int32_t tickRate = 60;
+		// Ticks a single frame may run to catch up, beyond that the game slows down instead
+		int32_t maxTicksPerFrame = 5;
+		int32_t width = 1280;
+		int32_t height = 720;
+		// Share of the window width that gets a ray, the view is stretched to the window
+		float resolutionScale = 1.0f;
+		// Milliseconds the resolution scale is adjusted to render a frame in, 0 keeps it fixed
+		float targetFrameTime = 0.0f;
+		// A camera path turns the run into a frame benchmark instead of the game loop
+		std::string cameraPath;
+		std::string benchmarkOutput;
+		std::string capturePath;
+		// Writes the input of every tick so the session can be replayed
+		std::string recordPath;
+		// Runs the ticks of a recording, headless runs skip rendering and check every tick
+		std::string replayPath;
+		// Profiles the whole run and writes the newest events as a Chrome trace on exit
+		std::string tracePath;
+		// Reports every frame past the warm up that allocates, and asserts in debug builds
+		bool strictAllocations = false;
+		// .opalmap files are mapped directly, anything else is read as a json map
+		std::string mapPath = "data/test_map.opalmap";
+		std::string assetPackPath = "assets/textures.opalpack";
+		// Sprites scattered over the open cells of the map, for trying out the sprite renderer
+		size_t spriteCount = 0;
+		// Bytes of decoded world chunks kept resident, larger maps are streamed
+		size_t worldMemoryBudget = World::StreamingSettings{}.memoryBudget;
+	};
+
+	Settings parseArguments(int32_t argc, char** argv);
+
+	void init(const Settings& settings);
 	void cleanup();
 	void loop();
 }
\ No newline at end of file
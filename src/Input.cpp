@@ -0,0 +1,132 @@
+#include <cstring>
+#include <iostream>
+#include "Input.hpp"
+#include "ReplayFormat.hpp"
+
+#include "raylib.h"
+
+static float s_Look = 0.0f;
+
+void Input::pollDevice()
+{
+	s_Look += GetMouseDelta().x;
+}
+
+Input::Frame Input::takeDeviceFrame()
+{
+	Frame frame;
+	frame.look = s_Look;
+	s_Look = 0.0f;
+
+	if (IsKeyDown(KEY_W)) frame.buttons |= Forward;
+	if (IsKeyDown(KEY_S)) frame.buttons |= Back;
+	if (IsKeyDown(KEY_A)) frame.buttons |= Left;
+	if (IsKeyDown(KEY_D)) frame.buttons |= Right;
+
+	return frame;
+}
+
+bool Input::Recorder::open(const std::string& path, const Session& session)
+{
+	m_File.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_File)
+	{
+		std::cerr << "Could not create recording " << path << std::endl;
+		return false;
+	}
+
+	ReplayFormat::Header header{};
+	std::memcpy(header.magic, ReplayFormat::k_Magic, sizeof(header.magic));
+	header.version = ReplayFormat::k_Version;
+	header.tickRate = session.tickRate;
+	header.worldMemoryBudget = session.worldMemoryBudget;
+	header.mapPathLength = (uint32_t)session.mapPath.size();
+	header.spriteCount = session.spriteCount;
+
+	m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_File.write(session.mapPath.data(), session.mapPath.size());
+	return true;
+}
+
+void Input::Recorder::write(const Frames& frames, uint64_t stateHash)
+{
+	const uint32_t count = (uint32_t)frames.size();
+	m_File.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+	for (const auto& [entity, frame] : frames)
+	{
+		ReplayFormat::FrameRecord record{};
+		record.entity = entity;
+		record.look = frame.look;
+		record.buttons = frame.buttons;
+		m_File.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	}
+
+	m_File.write(reinterpret_cast<const char*>(&stateHash), sizeof(stateHash));
+}
+
+bool Input::Replay::open(const std::string& path)
+{
+	if (!m_File.open(path))
+	{
+		std::cerr << "Could not map recording " << path << std::endl;
+		return false;
+	}
+
+	ReplayFormat::Header header;
+	const bool fits = m_File.size() >= sizeof(header);
+	if (fits) std::memcpy(&header, m_File.data(), sizeof(header));
+
+	if (!fits ||
+		std::memcmp(header.magic, ReplayFormat::k_Magic, sizeof(header.magic)) != 0 ||
+		header.version != ReplayFormat::k_Version ||
+		sizeof(header) + header.mapPathLength > m_File.size())
+	{
+		std::cerr << path << " is not a version " << ReplayFormat::k_Version << " recording" << std::endl;
+		m_File.close();
+		return false;
+	}
+
+	m_Session.tickRate = header.tickRate;
+	m_Session.worldMemoryBudget = header.worldMemoryBudget;
+	m_Session.mapPath.assign(reinterpret_cast<const char*>(m_File.data()) + sizeof(header), header.mapPathLength);
+	m_Session.spriteCount = header.spriteCount;
+
+	m_Offset = sizeof(header) + header.mapPathLength;
+	m_Tick = 0;
+	return true;
+}
+
+bool Input::Replay::next(Frames& frames, uint64_t& stateHash)
+{
+	frames.clear();
+	if (!m_File.isOpen()) return false;
+
+	uint32_t count = 0;
+	if (m_Offset + sizeof(count) <= m_File.size()) std::memcpy(&count, m_File.data() + m_Offset, sizeof(count));
+
+	// A tick cut short by the recording ending is not replayed
+	const size_t tickSize = sizeof(count) + (size_t)count * sizeof(ReplayFormat::FrameRecord) + sizeof(stateHash);
+	if (m_Offset + tickSize > m_File.size())
+	{
+		m_File.close();
+		return false;
+	}
+
+	const uint8_t* cursor = m_File.data() + m_Offset + sizeof(count);
+	for (uint32_t i = 0; i < count; ++i, cursor += sizeof(ReplayFormat::FrameRecord))
+	{
+		ReplayFormat::FrameRecord record;
+		std::memcpy(&record, cursor, sizeof(record));
+
+		Frame frame;
+		frame.look = record.look;
+		frame.buttons = record.buttons;
+		frames.emplace_back(record.entity, frame);
+	}
+
+	std::memcpy(&stateHash, cursor, sizeof(stateHash));
+	m_Offset += tickSize;
+	++m_Tick;
+	return true;
+}
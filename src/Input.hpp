@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include "Entity.hpp"
+#include "MappedFile.hpp"
+
+// Controllers hand the simulation one Frame per tick and entity instead of it
+// reading devices, so ticks can be recorded, replayed or fed from elsewhere
+namespace Input
+{
+	enum Button : uint8_t
+	{
+		Forward = 1 << 0,
+		Back = 1 << 1,
+		Left = 1 << 2,
+		Right = 1 << 3
+	};
+
+	struct Frame
+	{
+		uint8_t buttons = 0;
+		// Horizontal mouse movement since the previous tick
+		float look = 0.0f;
+
+		bool held(Button button) const { return buttons & button; }
+	};
+
+	using Frames = std::vector<std::pair<Entity, Frame>>;
+
+	// Gathers the mouse movement of a rendered frame, call it once per frame
+	void pollDevice();
+	// Keyboard state plus the mouse movement gathered since the last call
+	Frame takeDeviceFrame();
+
+	// What has to match for a recording to replay the same way
+	struct Session
+	{
+		uint32_t tickRate = 60;
+		size_t worldMemoryBudget = 0;
+		std::string mapPath;
+		uint32_t spriteCount = 0;
+	};
+
+	class Recorder
+	{
+	public:
+
+		bool open(const std::string& path, const Session& session);
+		bool isOpen() const { return m_File.is_open(); }
+		// One call per tick with the frames it ran on and the hash of the state it left
+		void write(const Frames& frames, uint64_t stateHash);
+
+	private:
+
+		std::ofstream m_File;
+	};
+
+	class Replay
+	{
+	public:
+
+		bool open(const std::string& path);
+		bool isOpen() const { return m_File.isOpen(); }
+		const Session& session() const { return m_Session; }
+		// Frames of the next recorded tick and the hash it has to end in. Once every
+		// tick was read it returns false and closes the recording.
+		bool next(Frames& frames, uint64_t& stateHash);
+		// Ticks read so far
+		size_t tick() const { return m_Tick; }
+
+	private:
+
+		MappedFile m_File;
+		Session m_Session;
+		size_t m_Offset = 0;
+		size_t m_Tick = 0;
+	};
+}
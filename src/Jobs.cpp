@@ -0,0 +1,254 @@
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+#include "Jobs.hpp"
+
+// Double ended queue on a power of two ring, it only allocates when it has to grow
+class TaskRing
+{
+public:
+
+	bool empty() const { return m_Head == m_Tail; }
+
+	void pushBack(Jobs::Task&& task)
+	{
+		if (m_Tail - m_Head == m_Tasks.size()) grow();
+		m_Tasks[m_Tail++ & (m_Tasks.size() - 1)] = std::move(task);
+	}
+
+	Jobs::Task popBack() { return std::move(m_Tasks[--m_Tail & (m_Tasks.size() - 1)]); }
+	Jobs::Task popFront() { return std::move(m_Tasks[m_Head++ & (m_Tasks.size() - 1)]); }
+
+private:
+
+	void grow()
+	{
+		Memory::Tag tag(Memory::Subsystem::Jobs);
+		std::vector<Jobs::Task> tasks(std::max<size_t>(m_Tasks.size() * 2, 64));
+
+		for (size_t i = m_Head; i != m_Tail; ++i)
+		{
+			tasks[i - m_Head] = std::move(m_Tasks[i & (m_Tasks.size() - 1)]);
+		}
+
+		m_Tail -= m_Head;
+		m_Head = 0;
+		m_Tasks.swap(tasks);
+	}
+
+	std::vector<Jobs::Task> m_Tasks;
+	size_t m_Head = 0;
+	size_t m_Tail = 0;
+};
+
+struct WorkerQueue
+{
+	std::mutex mutex;
+	TaskRing tasks;
+};
+
+static std::vector<std::thread> s_Workers;
+static std::vector<std::unique_ptr<WorkerQueue>> s_Queues;
+static std::atomic<size_t> s_QueuedTasks{ 0 };
+static std::atomic<size_t> s_NextQueue{ 0 };
+static std::atomic<bool> s_Stopping{ false };
+static std::mutex s_SleepMutex;
+static std::condition_variable s_WakeUp;
+
+static thread_local int32_t t_WorkerIndex = -1;
+
+static void runTask(Jobs::Task& task)
+{
+	Memory::Tag tag(task.subsystem);
+	task.job();
+	if (task.counter) task.counter->release();
+}
+
+static void pushTask(Jobs::Task task)
+{
+	if (s_Queues.empty())
+	{
+		runTask(task);
+		return;
+	}
+
+	// Workers push onto their own deque, everyone else spreads work round robin
+	size_t queueIndex = t_WorkerIndex >= 0 ?
+		t_WorkerIndex : s_NextQueue.fetch_add(1, std::memory_order_relaxed) % s_Queues.size();
+
+	{
+		std::lock_guard lock(s_Queues[queueIndex]->mutex);
+		s_Queues[queueIndex]->tasks.pushBack(std::move(task));
+	}
+	{
+		std::lock_guard lock(s_SleepMutex);
+		++s_QueuedTasks;
+	}
+	s_WakeUp.notify_one();
+}
+
+static bool popTask(int32_t workerIndex, Jobs::Task& out)
+{
+	if (s_QueuedTasks.load(std::memory_order_acquire) == 0) return false;
+
+	const size_t queueCount = s_Queues.size();
+	const size_t first = workerIndex >= 0 ? workerIndex : 0;
+
+	for (size_t offset = 0; offset < queueCount; ++offset)
+	{
+		auto& queue = *s_Queues[(first + offset) % queueCount];
+		std::lock_guard lock(queue.mutex);
+
+		if (queue.tasks.empty()) continue;
+
+		// The owner takes its newest task, thieves take the oldest one
+		out = offset == 0 && workerIndex >= 0 ? queue.tasks.popBack() : queue.tasks.popFront();
+
+		--s_QueuedTasks;
+		return true;
+	}
+
+	return false;
+}
+
+static void workerLoop(int32_t workerIndex)
+{
+	t_WorkerIndex = workerIndex;
+
+	while (!s_Stopping)
+	{
+		Jobs::Task task;
+		if (popTask(workerIndex, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		std::unique_lock lock(s_SleepMutex);
+		s_WakeUp.wait(lock, [] { return s_Stopping || s_QueuedTasks > 0; });
+	}
+}
+
+void Jobs::Counter::release()
+{
+	std::vector<Task> continuations;
+	{
+		// Decrementing under the lock lets wait() know when it is safe to destroy us
+		std::lock_guard lock(m_Mutex);
+		if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+		continuations.swap(m_Continuations);
+	}
+
+	for (auto& task : continuations)
+	{
+		pushTask(std::move(task));
+	}
+}
+
+void Jobs::init(size_t workerCount)
+{
+	s_Stopping = false;
+	workerCount = std::min(workerCount, k_MaxWorkers);
+
+	for (size_t i = 0; i < workerCount; ++i)
+	{
+		s_Queues.push_back(std::make_unique<WorkerQueue>());
+	}
+
+	for (size_t i = 0; i < workerCount; ++i)
+	{
+		s_Workers.emplace_back(workerLoop, (int32_t)i);
+	}
+}
+
+void Jobs::shutdown()
+{
+	{
+		std::lock_guard lock(s_SleepMutex);
+		s_Stopping = true;
+	}
+	s_WakeUp.notify_all();
+
+	for (auto& worker : s_Workers)
+	{
+		worker.join();
+	}
+
+	s_Workers.clear();
+	s_Queues.clear();
+	s_QueuedTasks = 0;
+}
+
+size_t Jobs::workerCount() { return s_Workers.size(); }
+size_t Jobs::threadIndex() { return t_WorkerIndex + 1; }
+
+void Jobs::submit(Job job, Counter* counter, Counter* dependency)
+{
+	if (counter) counter->add(1);
+
+	Task task{ std::move(job), counter, Memory::currentSubsystem() };
+
+	if (dependency)
+	{
+		std::lock_guard lock(dependency->m_Mutex);
+
+		if (!dependency->done())
+		{
+			dependency->m_Continuations.push_back(std::move(task));
+			return;
+		}
+	}
+
+	pushTask(std::move(task));
+}
+
+void Jobs::wait(Counter& counter)
+{
+	while (!counter.done())
+	{
+		Task task;
+		if (popTask(t_WorkerIndex, task))
+		{
+			runTask(task);
+			continue;
+		}
+
+		std::this_thread::yield();
+	}
+
+	std::lock_guard lock(counter.m_Mutex);
+}
+
+void Jobs::parallelFor(size_t begin, size_t end, size_t grainSize, RangeJob body)
+{
+	if (begin >= end) return;
+
+	grainSize = std::max<size_t>(grainSize, 1);
+
+	if (s_Workers.empty() || end - begin <= grainSize)
+	{
+		body(begin, end);
+		return;
+	}
+
+	Counter counter;
+
+	// Jobs capture one pointer and their first index, small enough for std::function to store inline
+	struct Shared
+	{
+		RangeJob body;
+		size_t grainSize;
+		size_t end;
+	} shared{ body, grainSize, end };
+
+	// The caller keeps the first range for itself instead of idling in wait
+	for (size_t rangeBegin = begin + grainSize; rangeBegin < end; rangeBegin += grainSize)
+	{
+		submit([&shared, rangeBegin] { shared.body(rangeBegin, std::min(rangeBegin + shared.grainSize, shared.end)); }, &counter);
+	}
+
+	body(begin, begin + grainSize);
+	wait(counter);
+}
\ No newline at end of file
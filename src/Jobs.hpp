@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <type_traits>
+#include "Memory.hpp"
+
+namespace Jobs
+{
+	using Job = std::function<void()>;
+
+	// Non owning reference to a callable taking a begin and an end index. It only
+	// lives for the parallelFor call, so passing a lambda never allocates.
+	class RangeJob
+	{
+	public:
+
+		template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, RangeJob>>>
+		RangeJob(F&& function) :
+			m_Function((void*)std::addressof(function)),
+			m_Call([](void* function, size_t begin, size_t end) { (*static_cast<std::remove_reference_t<F>*>(function))(begin, end); }) {}
+
+		void operator()(size_t begin, size_t end) const { m_Call(m_Function, begin, end); }
+
+	private:
+
+		void* m_Function;
+		void (*m_Call)(void*, size_t, size_t);
+	};
+
+	class Counter;
+
+	struct Task
+	{
+		Job job;
+		Counter* counter = nullptr;
+		// Allocations of the job count against whoever submitted it
+		Memory::Subsystem subsystem = Memory::Subsystem::Other;
+	};
+
+	// Tracks how many submitted jobs are still running. Jobs submitted with a
+	// counter as their dependency start only once it reaches zero.
+	class Counter
+	{
+	public:
+
+		Counter() = default;
+		Counter(const Counter&) = delete;
+		Counter& operator=(const Counter&) = delete;
+
+		bool done() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+		void add(int32_t count) { m_Pending.fetch_add(count, std::memory_order_relaxed); }
+		// Marks one unit of work as finished, releasing dependent jobs on the last one
+		void release();
+
+	private:
+
+		friend void submit(Job job, Counter* counter, Counter* dependency);
+		friend void wait(Counter& counter);
+
+		std::atomic<int32_t> m_Pending{ 0 };
+		std::mutex m_Mutex;
+		std::vector<Task> m_Continuations;
+	};
+
+	// Lets per thread data live in fixed arrays indexed by threadIndex
+	constexpr size_t k_MaxWorkers = 63;
+
+	// 0 workers keeps every job on the calling thread, which is handy for debugging
+	void init(size_t workerCount);
+	void shutdown();
+	size_t workerCount();
+	// 0 on threads outside the pool, 1 + the worker index on workers
+	size_t threadIndex();
+
+	void submit(Job job, Counter* counter = nullptr, Counter* dependency = nullptr);
+	// Runs queued jobs on the calling thread until the counter reaches zero
+	void wait(Counter& counter);
+	void parallelFor(size_t begin, size_t end, size_t grainSize, RangeJob body);
+}
\ No newline at end of file
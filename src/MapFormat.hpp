@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Layout of .opalmap files written by opal_mapc. Everything is little endian and
+// the cells are stored exactly as World keeps them in memory, so a mapped file
+// is used without copying.
+namespace MapFormat
+{
+	constexpr char k_Magic[8] = { 'O', 'P', 'A', 'L', 'M', 'A', 'P', '\0' };
+	constexpr uint32_t k_Version = 3;
+	constexpr size_t k_NameLength = 32;
+	constexpr int32_t k_ChunkSize = 64;
+	// Cells start on a page boundary so chunks map in whole pages
+	constexpr size_t k_CellsAlignment = 4096;
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		int32_t width;
+		int32_t height;
+		int32_t chunkSize;
+		float spawnX;
+		float spawnY;
+		uint32_t paletteCount;
+		uint32_t reserved;
+		uint64_t paletteOffset;
+		uint64_t cellsOffset;
+		uint64_t cellsSize;
+		// See World::Lighting
+		float ambientLight;
+		float fogStart;
+		float fogEnd;
+		uint8_t fogColor[4];
+	};
+
+	// Index 0 is always empty space and has empty names, so do untextured surfaces
+	struct PaletteEntry
+	{
+		char textureName[k_NameLength];
+		char floorName[k_NameLength];
+		char ceilingName[k_NameLength];
+		float light;
+	};
+
+	// Cells are one palette index per tile, grouped into chunkSize x chunkSize
+	// chunks stored row by row, with the rows inside a chunk also stored in order
+	inline size_t chunkCount(int32_t size, int32_t chunkSize) { return (size + chunkSize - 1) / chunkSize; }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Read only view of a whole file through the OS page cache
+class MappedFile
+{
+public:
+
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return m_Data != nullptr; }
+	const uint8_t* data() const { return m_Data; }
+	size_t size() const { return m_Size; }
+	// Whether [offset, offset + size) lies inside the file, without overflowing on untrusted values
+	bool contains(uint64_t offset, uint64_t size) const { return offset <= m_Size && size <= m_Size - offset; }
+
+private:
+
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+#if defined(_WIN32)
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
@@ -0,0 +1,234 @@
+#include <array>
+#include <new>
+#include <cstdlib>
+#if defined(_WIN32)
+	#include <malloc.h>
+#endif
+#include <cassert>
+#include <iostream>
+#include "Memory.hpp"
+
+static constexpr size_t k_SubsystemCount = (size_t)Memory::Subsystem::Count;
+
+// Constant initialized, so allocations made before main are counted too
+static std::array<std::atomic<uint64_t>, k_SubsystemCount> s_Allocations{};
+static std::array<std::atomic<uint64_t>, k_SubsystemCount> s_Bytes{};
+static std::array<Memory::Counters, k_SubsystemCount> s_FrameStart{};
+static std::array<Memory::Counters, k_SubsystemCount> s_LastFrame{};
+static uint64_t s_Frames = 0;
+static bool s_StrictFrames = false;
+
+static thread_local Memory::Subsystem t_Subsystem = Memory::Subsystem::Other;
+
+static void countAllocation(size_t bytes)
+{
+	const size_t subsystem = (size_t)t_Subsystem;
+	s_Allocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+	s_Bytes[subsystem].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size)
+{
+	countAllocation(size);
+	if (void* pointer = std::malloc(size ? size : 1)) return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	countAllocation(size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+
+// The structure of arrays columns come through these
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	countAllocation(size);
+	const size_t bytes = ((size ? size : 1) + (size_t)alignment - 1) & ~((size_t)alignment - 1);
+#if defined(_WIN32)
+	if (void* pointer = _aligned_malloc(bytes, (size_t)alignment)) return pointer;
+#else
+	if (void* pointer = std::aligned_alloc((size_t)alignment, bytes)) return pointer;
+#endif
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return ::operator new(size, alignment);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+#if defined(_WIN32)
+	_aligned_free(pointer);
+#else
+	std::free(pointer);
+#endif
+}
+
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { ::operator delete(pointer, alignment); }
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept { ::operator delete(pointer, alignment); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept { ::operator delete(pointer, alignment); }
+
+const char* Memory::name(Subsystem subsystem)
+{
+	switch (subsystem)
+	{
+	case Subsystem::Simulation: return "simulation";
+	case Subsystem::Entities: return "entities";
+	case Subsystem::World: return "world";
+	case Subsystem::Rendering: return "rendering";
+	case Subsystem::Jobs: return "jobs";
+	default: return "other";
+	}
+}
+
+Memory::Tag::Tag(Subsystem subsystem) : m_Previous(t_Subsystem)
+{
+	t_Subsystem = subsystem;
+}
+
+Memory::Tag::~Tag()
+{
+	t_Subsystem = m_Previous;
+}
+
+Memory::Subsystem Memory::currentSubsystem() { return t_Subsystem; }
+
+Memory::Counters Memory::total(Subsystem subsystem)
+{
+	return {
+		s_Allocations[(size_t)subsystem].load(std::memory_order_relaxed),
+		s_Bytes[(size_t)subsystem].load(std::memory_order_relaxed)
+	};
+}
+
+Memory::Counters Memory::lastFrame(Subsystem subsystem) { return s_LastFrame[(size_t)subsystem]; }
+
+void Memory::setStrictFrames(bool strict) { s_StrictFrames = strict; }
+
+void Memory::endFrame()
+{
+	uint64_t allocations = 0;
+
+	for (size_t i = 0; i < k_SubsystemCount; ++i)
+	{
+		const Counters now = total((Subsystem)i);
+		s_LastFrame[i] = { now.allocations - s_FrameStart[i].allocations, now.bytes - s_FrameStart[i].bytes };
+		s_FrameStart[i] = now;
+		allocations += s_LastFrame[i].allocations;
+	}
+
+	frameArena().reset();
+
+	if (!s_StrictFrames || ++s_Frames <= k_WarmupFrames || !allocations) return;
+
+	std::cerr << "Frame " << s_Frames << " made " << allocations << " heap allocations:";
+	for (size_t i = 0; i < k_SubsystemCount; ++i)
+	{
+		if (s_LastFrame[i].allocations) std::cerr << " " << name((Subsystem)i) << " " << s_LastFrame[i].allocations;
+	}
+	std::cerr << std::endl;
+
+	assert(!"Steady state frames must not allocate");
+}
+
+Memory::FrameArena::FrameArena(size_t capacity) :
+	m_Buffer(std::make_unique<std::byte[]>(capacity)),
+	m_Capacity(capacity) {}
+
+void* Memory::FrameArena::allocate(size_t bytes, size_t alignment)
+{
+	// Reserving the worst case padding keeps this a single atomic add
+	const size_t reserved = bytes + alignment - 1;
+	const size_t offset = m_Offset.fetch_add(reserved, std::memory_order_relaxed);
+
+	if (offset + reserved <= m_Capacity)
+	{
+		const uintptr_t address = reinterpret_cast<uintptr_t>(m_Buffer.get()) + offset;
+		return reinterpret_cast<void*>((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	}
+
+	// Past the arena, over aligned types still need their alignment from the heap
+	if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) return ::operator new(bytes, std::align_val_t{ alignment });
+	return ::operator new(bytes);
+}
+
+void Memory::FrameArena::deallocate(void* pointer, size_t alignment)
+{
+	const std::byte* address = static_cast<const std::byte*>(pointer);
+	if (address >= m_Buffer.get() && address < m_Buffer.get() + m_Capacity) return;
+
+	if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ::operator delete(pointer, std::align_val_t{ alignment });
+	else ::operator delete(pointer);
+}
+
+void Memory::FrameArena::reset()
+{
+	m_Offset.store(0, std::memory_order_relaxed);
+}
+
+Memory::FrameArena& Memory::frameArena()
+{
+	static FrameArena arena(k_FrameArenaSize);
+	return arena;
+}
+
+// Rounded up so every block in a slab stays aligned for any type
+Memory::BlockPool::BlockPool(size_t blockSize, size_t blocksPerSlab) :
+	m_BlockSize((std::max(blockSize, sizeof(FreeBlock)) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1)),
+	m_BlocksPerSlab(std::max<size_t>(blocksPerSlab, 1)) {}
+
+Memory::BlockPool::~BlockPool()
+{
+	for (std::byte* slab : m_Slabs)
+	{
+		delete[] slab;
+	}
+}
+
+void* Memory::BlockPool::allocate()
+{
+	std::lock_guard lock(m_Mutex);
+
+	if (!m_Free)
+	{
+		std::byte* slab = new std::byte[m_BlockSize * m_BlocksPerSlab];
+		m_Slabs.push_back(slab);
+
+		// Threaded back to front so blocks are handed out in address order
+		for (size_t i = m_BlocksPerSlab; i-- > 0;)
+		{
+			m_Free = new (slab + i * m_BlockSize) FreeBlock{ m_Free };
+		}
+	}
+
+	FreeBlock* block = m_Free;
+	m_Free = block->next;
+	m_InUse.fetch_add(1, std::memory_order_relaxed);
+	return block;
+}
+
+void Memory::BlockPool::deallocate(void* block)
+{
+	std::lock_guard lock(m_Mutex);
+
+	m_Free = new (block) FreeBlock{ m_Free };
+	m_InUse.fetch_sub(1, std::memory_order_relaxed);
+}
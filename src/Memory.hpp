@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Heap accounting per subsystem, the per frame arena and fixed size block pools.
+// Every global operator new is counted against the subsystem tagged on the
+// calling thread.
+namespace Memory
+{
+	enum class Subsystem : uint8_t
+	{
+		Other,
+		Simulation,
+		Entities,
+		World,
+		Rendering,
+		Jobs,
+		Count
+	};
+
+	const char* name(Subsystem subsystem);
+
+	struct Counters
+	{
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+	};
+
+	// Allocations made on this thread while the tag lives are charged to its subsystem
+	class Tag
+	{
+	public:
+
+		explicit Tag(Subsystem subsystem);
+		~Tag();
+
+		Tag(const Tag&) = delete;
+		Tag& operator=(const Tag&) = delete;
+
+	private:
+
+		Subsystem m_Previous;
+	};
+
+	Subsystem currentSubsystem();
+	// Running totals since startup
+	Counters total(Subsystem subsystem);
+	// What the last frame closed by endFrame allocated
+	Counters lastFrame(Subsystem subsystem);
+
+	// Frames after startup that may still allocate while buffers and pools grow
+	constexpr uint64_t k_WarmupFrames = 120;
+
+	// Closes the counts of the frame and rewinds the frame arena. With strict
+	// frames on, a frame past the warm up that touched the heap is reported and
+	// fails an assertion in debug builds.
+	void endFrame();
+	void setStrictFrames(bool strict);
+
+	// Linear allocator for data that dies with the frame. Allocating is a single
+	// atomic add, so jobs may use it too. Once full it falls back to the heap,
+	// which shows up in the counters.
+	class FrameArena
+	{
+	public:
+
+		explicit FrameArena(size_t capacity);
+
+		void* allocate(size_t bytes, size_t alignment);
+		// Only heap fallbacks are freed, arena memory comes back with reset.
+		// alignment has to match the one the pointer was allocated with.
+		void deallocate(void* pointer, size_t alignment);
+		// Nothing allocated before may be used afterwards
+		void reset();
+
+		size_t used() const { return std::min(m_Offset.load(std::memory_order_relaxed), m_Capacity); }
+		size_t capacity() const { return m_Capacity; }
+
+	private:
+
+		std::unique_ptr<std::byte[]> m_Buffer;
+		size_t m_Capacity;
+		std::atomic<size_t> m_Offset{ 0 };
+	};
+
+	constexpr size_t k_FrameArenaSize = 8 << 20;
+	FrameArena& frameArena();
+
+	template <typename T>
+	class FrameAllocator
+	{
+	public:
+
+		using value_type = T;
+
+		FrameAllocator() = default;
+		template <typename U>
+		FrameAllocator(const FrameAllocator<U>&) {}
+
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(frameArena().allocate(count * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* pointer, size_t)
+		{
+			frameArena().deallocate(pointer, alignof(T));
+		}
+
+		template <typename U>
+		bool operator==(const FrameAllocator<U>&) const { return true; }
+	};
+
+	// Scratch vector for the current frame, see FrameArena
+	template <typename T>
+	using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+	// Hands out blocks of one size from slabs that are never returned to the
+	// heap, freed blocks are reused first. Thread safe.
+	class BlockPool
+	{
+	public:
+
+		BlockPool(size_t blockSize, size_t blocksPerSlab);
+		~BlockPool();
+
+		BlockPool(const BlockPool&) = delete;
+		BlockPool& operator=(const BlockPool&) = delete;
+
+		void* allocate();
+		void deallocate(void* block);
+
+		size_t blockSize() const { return m_BlockSize; }
+		size_t blocksInUse() const { return m_InUse.load(std::memory_order_relaxed); }
+
+	private:
+
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		size_t m_BlockSize;
+		size_t m_BlocksPerSlab;
+		std::atomic<size_t> m_InUse{ 0 };
+		std::mutex m_Mutex;
+		FreeBlock* m_Free = nullptr;
+		std::vector<std::byte*> m_Slabs;
+	};
+}
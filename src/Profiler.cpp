@@ -0,0 +1,164 @@
+#include <array>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include "Profiler.hpp"
+#include "Jobs.hpp"
+
+struct Event
+{
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+};
+
+// Single producer ring, only the thread with this index writes it. Threads
+// outside the pool share the main thread's ring, so only the main thread may
+// record there.
+struct Ring
+{
+	std::unique_ptr<Event[]> events;
+	// Events ever written, published after the event itself
+	std::atomic<uint64_t> written{ 0 };
+	// Events endFrame already summed
+	uint64_t gathered = 0;
+};
+
+// Weight of the newest frame in the rolling timings
+static constexpr float k_Smoothing = 0.05f;
+
+static const auto s_Epoch = std::chrono::steady_clock::now();
+static std::array<Ring, Jobs::k_MaxWorkers + 1> s_Rings;
+// Keyed by the text, the same literal can have a different address in every translation unit
+static std::map<std::string_view, float> s_Averages;
+static std::vector<Profiler::Timing> s_Timings;
+static std::vector<float> s_FrameTimes;
+// Kept between frames so a steady frame adds no map nodes
+static std::map<std::string_view, float> s_Frame;
+static std::vector<Event> s_Events;
+
+void Profiler::setEnabled(bool enabled)
+{
+	if (enabled)
+	{
+		for (size_t i = 0; i <= Jobs::workerCount(); ++i)
+		{
+			if (!s_Rings[i].events) s_Rings[i].events = std::make_unique<Event[]>(k_RingSize);
+		}
+	}
+
+	s_Enabled.store(enabled, std::memory_order_release);
+}
+
+uint64_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_Epoch).count();
+}
+
+void Profiler::record(const char* name, uint64_t begin, uint64_t end)
+{
+	Ring& ring = s_Rings[Jobs::threadIndex()];
+	if (!ring.events) return;
+
+	const uint64_t written = ring.written.load(std::memory_order_relaxed);
+	ring.events[written & (k_RingSize - 1)] = { name, begin, end };
+	ring.written.store(written + 1, std::memory_order_release);
+}
+
+// Copies the events from index first on that are still in the ring and returns
+// the index after the last one. Anything the writer lapped while it was being
+// copied is dropped instead of read torn.
+static uint64_t readRing(const Ring& ring, uint64_t first, std::vector<Event>& events)
+{
+	events.clear();
+	if (!ring.events) return first;
+
+	const uint64_t written = ring.written.load(std::memory_order_acquire);
+	first = std::max(first, written > Profiler::k_RingSize ? written - Profiler::k_RingSize : 0);
+
+	for (uint64_t i = first; i < written; ++i)
+	{
+		events.push_back(ring.events[i & (Profiler::k_RingSize - 1)]);
+	}
+
+	const uint64_t after = ring.written.load(std::memory_order_acquire);
+	const uint64_t overwritten = after > Profiler::k_RingSize ? after - Profiler::k_RingSize : 0;
+	if (overwritten > first) events.erase(events.begin(), events.begin() + std::min<uint64_t>(overwritten - first, events.size()));
+
+	return written;
+}
+
+void Profiler::endFrame(float frameSeconds)
+{
+	s_FrameTimes.push_back(frameSeconds * 1000.0f);
+	if (s_FrameTimes.size() > k_FrameHistory) s_FrameTimes.erase(s_FrameTimes.begin());
+
+	// Work spread over the workers adds up, so a parallel system shows its total cost
+	for (auto& [name, milliseconds] : s_Frame) milliseconds = 0.0f;
+
+	for (Ring& ring : s_Rings)
+	{
+		ring.gathered = readRing(ring, ring.gathered, s_Events);
+
+		for (const Event& event : s_Events)
+		{
+			s_Frame[event.name] += (float)(event.end - event.begin) * 1e-6f;
+		}
+	}
+
+	for (const auto& [name, milliseconds] : s_Frame) s_Averages.try_emplace(name, milliseconds);
+
+	s_Timings.clear();
+	for (auto& [name, average] : s_Averages)
+	{
+		average += (s_Frame[name] - average) * k_Smoothing;
+		s_Timings.push_back({ name.data(), average });
+	}
+}
+
+const std::vector<Profiler::Timing>& Profiler::timings() { return s_Timings; }
+const std::vector<float>& Profiler::frameTimes() { return s_FrameTimes; }
+
+bool Profiler::exportChromeTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Could not create trace " << path << std::endl;
+		return false;
+	}
+
+	// Complete events in microseconds, one trace thread per ring
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	file.setf(std::ios::fixed);
+	file.precision(3);
+
+	bool first = true;
+	std::vector<Event> events;
+
+	for (size_t thread = 0; thread < s_Rings.size(); ++thread)
+	{
+		if (!s_Rings[thread].events) continue;
+
+		file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+			<< ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+			<< (thread ? "worker " + std::to_string(thread - 1) : std::string("main")) << "\"}}";
+		first = false;
+
+		readRing(s_Rings[thread], 0, events);
+		for (const Event& event : events)
+		{
+			file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+				<< ",\"name\":\"" << event.name
+				<< "\",\"ts\":" << (double)event.begin * 1e-3
+				<< ",\"dur\":" << (double)(event.end - event.begin) * 1e-3 << "}";
+		}
+	}
+
+	file << "\n]}\n";
+	return (bool)file;
+}
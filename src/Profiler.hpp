@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Scoped timing markers. Each thread appends to its own ring buffer, the main
+// thread reads them between frames for the overlay and the trace export. Built
+// with OPAL_PROFILER_DISABLED the markers compile to nothing.
+namespace Profiler
+{
+	// Events kept per thread, older ones are overwritten
+	constexpr size_t k_RingSize = 1 << 15;
+	// Frames shown by the frame time graph
+	constexpr size_t k_FrameHistory = 240;
+
+	inline std::atomic<bool> s_Enabled{ false };
+
+	// Allocates the rings on first use, call it from the main thread after Jobs::init
+	void setEnabled(bool enabled);
+	inline bool enabled() { return s_Enabled.load(std::memory_order_acquire); }
+
+	// Nanoseconds on a monotonic clock
+	uint64_t now();
+	// name has to outlive the profiler, markers only ever pass string literals
+	void record(const char* name, uint64_t begin, uint64_t end);
+
+	class Scope
+	{
+	public:
+
+		explicit Scope(const char* name) :
+			m_Name(enabled() ? name : nullptr),
+			m_Begin(m_Name ? now() : 0) {}
+
+		~Scope()
+		{
+			if (m_Name) record(m_Name, m_Begin, now());
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+
+		const char* m_Name;
+		uint64_t m_Begin;
+	};
+
+	struct Timing
+	{
+		const char* name;
+		// Rolling average over the last few dozen frames, summed over every thread
+		float milliseconds;
+	};
+
+	// Gathers the events recorded since the previous call into the rolling timings
+	void endFrame(float frameSeconds);
+	// Sorted by name so the overlay rows stay in place
+	const std::vector<Timing>& timings();
+	// Oldest first, at most k_FrameHistory entries
+	const std::vector<float>& frameTimes();
+
+	// Writes every event still in the rings as Chrome trace json, which Perfetto opens too
+	bool exportChromeTrace(const std::string& path);
+}
+
+#define OPAL_PROFILE_JOIN_(a, b) a##b
+#define OPAL_PROFILE_JOIN(a, b) OPAL_PROFILE_JOIN_(a, b)
+
+#if defined(OPAL_PROFILER_DISABLED)
+	#define OPAL_PROFILE_SCOPE(name)
+#else
+	#define OPAL_PROFILE_SCOPE(name) Profiler::Scope OPAL_PROFILE_JOIN(profileScope, __LINE__)(name)
+#endif
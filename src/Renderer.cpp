@@ -2,37 +2,245 @@
 #include <utility>
 #include <fstream>
 #include <vector>
+#include <array>
 #include <queue>
+#include <cstring>
+#include <chrono>
+#include <limits>
 #include "Renderer.hpp"
 #include "Window.hpp"
 #include "Systems.hpp"
+#include "Jobs.hpp"
+#include "Profiler.hpp"
+#include "Memory.hpp"
+#include "TextureStore.hpp"
+#include "MappedFile.hpp"
+#include "AssetPackFormat.hpp"
+#include "Simd.hpp"
 
 #include "RayCore.hpp"
 
-static std::queue<std::pair<std::string, Image>> s_LoadingQueue;
+struct LoadingImage
+{
+	std::string stringId;
+	Image image;
+	// Images from the asset pack point into the mapped file and are never freed
+	bool owned;
+};
+
+static std::queue<LoadingImage> s_LoadingQueue;
+static MappedFile s_AssetPack;
 static std::unordered_map<std::string, TextureId> s_IntIds;
 static std::vector<Texture> s_Textures;
 
-void Renderer::beginDrawing() { BeginDrawing(); }
-void Renderer::endDrawing() { EndDrawing(); }
-void Renderer::clearBackground(Col color) { ClearBackground(toRay(color)); };
+static TextureStore s_TextureStore;
+
+static Renderer::RenderMode s_RenderMode = Renderer::RenderMode::Gpu;
+static bool s_FloorCasting = true;
+static std::vector<Col> s_Framebuffer;
+static int32_t s_FramebufferWidth = 0;
+static int32_t s_FramebufferHeight = 0;
+static Texture s_FramebufferTexture{};
+static bool s_FramebufferDrawn = false;
+
+static Renderer::FrameStats s_CurrentStats;
+static Renderer::FrameStats s_LastStats;
+
+// Resolution scales move in steps of this, so frame time noise does not rebuild the ray table every frame
+static constexpr float k_ResolutionStep = 1.0f / 32.0f;
+// Weight of the newest frame in the render time the controller reacts to
+static constexpr float k_RenderTimeSmoothing = 0.1f;
+static float s_ResolutionScale = 1.0f;
+static float s_TargetFrameTime = 0.0f;
+static float s_AverageRenderTime = 0.0f;
+static std::chrono::steady_clock::time_point s_FrameStart;
+
+static void presentFramebuffer();
+static void flushFramebuffer();
+static void updateResolutionScale(float renderTime);
+
+void Renderer::setRenderMode(RenderMode mode) { s_RenderMode = mode; }
+Renderer::RenderMode Renderer::getRenderMode() { return s_RenderMode; }
+void Renderer::setFloorCasting(bool enabled) { s_FloorCasting = enabled; }
+bool Renderer::getFloorCasting() { return s_FloorCasting; }
+
+void Renderer::setResolutionScale(float scale)
+{
+	s_ResolutionScale = std::clamp(std::round(scale / k_ResolutionStep) * k_ResolutionStep, k_MinResolutionScale, 1.0f);
+}
+
+float Renderer::getResolutionScale() { return s_ResolutionScale; }
+
+void Renderer::setTargetFrameTime(float seconds)
+{
+	s_TargetFrameTime = std::max(seconds, 0.0f);
+	s_AverageRenderTime = s_TargetFrameTime;
+}
+
+const Renderer::FrameStats& Renderer::getFrameStats() { return s_LastStats; }
+
+void Renderer::beginDrawing()
+{
+	s_CurrentStats = {};
+	if (!Window::isHeadless()) BeginDrawing();
+	s_FrameStart = std::chrono::steady_clock::now();
+}
+
+void Renderer::endDrawing()
+{
+	OPAL_PROFILE_SCOPE("Renderer::endDrawing");
+	Memory::Tag tag(Memory::Subsystem::Rendering);
+
+	flushFramebuffer();
+
+	// Taken before presenting, waiting for vsync is not rendering time
+	updateResolutionScale(std::chrono::duration<float>(std::chrono::steady_clock::now() - s_FrameStart).count());
+
+	s_LastStats = s_CurrentStats;
+	if (!Window::isHeadless()) EndDrawing();
+
+	Memory::endFrame();
+}
+
+// Rendering costs about the same per column, so the scale that meets the target
+// is proportional to the current one. Aims a little under the target and only
+// reacts outside a dead band, a scale that just fits would flip every frame.
+void updateResolutionScale(float renderTime)
+{
+	if (s_TargetFrameTime <= 0.0f) return;
+
+	s_AverageRenderTime += (renderTime - s_AverageRenderTime) * k_RenderTimeSmoothing;
+	if (s_AverageRenderTime < s_TargetFrameTime && s_AverageRenderTime > s_TargetFrameTime * 0.75f) return;
+
+	const float previous = s_ResolutionScale;
+	Renderer::setResolutionScale(previous * s_TargetFrameTime * 0.9f / s_AverageRenderTime);
+
+	// Expect the new cost right away instead of waiting for the average to catch up
+	s_AverageRenderTime *= s_ResolutionScale / previous;
+}
+
+void flushFramebuffer()
+{
+	if (!s_FramebufferDrawn) return;
+
+	// Headless runs skip the blit but still count it, so their numbers match a windowed frame
+	if (!Window::isHeadless()) presentFramebuffer();
+	++s_CurrentStats.drawCalls;
+	s_FramebufferDrawn = false;
+}
+
+void Renderer::clearBackground(Col color)
+{
+	if (!Window::isHeadless()) ClearBackground(toRay(color));
+}
 
 void Renderer::loadImages(const nlohmann::json& mapping)
 {
+	std::vector<std::pair<std::string, std::string>> entries;
 	for (const auto& [key, path] : mapping.items())
 	{
-		s_LoadingQueue.push({ key, LoadImage(path.get<std::string>().c_str()) });
+		entries.emplace_back(key, path.get<std::string>());
+	}
+
+	std::vector<Image> images(entries.size());
+
+	// stb_image keeps no shared state, so every file can decode on its own worker
+	Jobs::parallelFor(0, entries.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			images[i] = LoadImage(entries[i].second.c_str());
+			ImageFormat(&images[i], PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		}
+	});
+
+	// Queued in file order so texture ids do not depend on which worker finished first
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		s_LoadingQueue.push({ entries[i].first, images[i], true });
 	}
 }
 
+bool Renderer::loadAssetPack(const std::string& path)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		std::cerr << "Could not map " << path << std::endl;
+		return false;
+	}
+
+	AssetPackFormat::Header header;
+	if (file.size() < sizeof(header))
+	{
+		std::cerr << path << " is too small to be an asset pack" << std::endl;
+		return false;
+	}
+
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, AssetPackFormat::k_Magic, sizeof(header.magic)) != 0 ||
+		header.version != AssetPackFormat::k_Version ||
+		!file.contains(header.indexOffset, (uint64_t)header.entryCount * sizeof(AssetPackFormat::Entry)))
+	{
+		std::cerr << path << " is not a version " << AssetPackFormat::k_Version << " asset pack" << std::endl;
+		return false;
+	}
+
+	std::vector<LoadingImage> images;
+
+	for (uint32_t i = 0; i < header.entryCount; ++i)
+	{
+		AssetPackFormat::Entry entry;
+		std::memcpy(&entry, file.data() + header.indexOffset + i * sizeof(entry), sizeof(entry));
+
+		if (entry.width <= 0 || entry.height <= 0 || entry.mipmaps <= 0 ||
+			entry.pixelsSize != AssetPackFormat::pixelsSize(entry.width, entry.height, entry.mipmaps) ||
+			!file.contains(entry.pixelsOffset, entry.pixelsSize))
+		{
+			std::cerr << path << " is truncated or corrupted" << std::endl;
+			return false;
+		}
+
+		Image image{};
+		image.data = const_cast<uint8_t*>(file.data() + entry.pixelsOffset);
+		image.width = entry.width;
+		image.height = entry.height;
+		image.mipmaps = entry.mipmaps;
+		image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+		images.push_back({ std::string(entry.name, strnlen(entry.name, AssetPackFormat::k_NameLength)), image, false });
+	}
+
+	for (auto& image : images)
+	{
+		s_LoadingQueue.push(std::move(image));
+	}
+
+	// Moving the mapping keeps the pointers above valid
+	s_AssetPack = std::move(file);
+	return true;
+}
+
 bool Renderer::loadTexturesFromImages()
 {
 	if (s_LoadingQueue.empty()) return true;
 
-	const auto& [stringId, image] = s_LoadingQueue.front();
-	s_Textures.push_back(LoadTextureFromImage(image));
-	s_IntIds[stringId] = s_Textures.size() - 1;
-	UnloadImage(image);
+	const auto& [stringId, image, owned] = s_LoadingQueue.front();
+	const TextureId id = s_IntIds.size();
+	s_IntIds[stringId] = id;
+
+	// Without a window there is no GPU context, headless rendering only needs the CPU copies
+	if (!Window::isHeadless()) s_Textures.push_back(LoadTextureFromImage(image));
+
+	// Both loaders hand over RGBA8, so level 0 is already laid out as Col
+	static_assert(sizeof(Color) == sizeof(Col));
+	if (image.data)
+	{
+		s_TextureStore.add(id, static_cast<const Col*>(image.data), image.width, image.height);
+	}
+
+	if (owned) UnloadImage(image);
 	s_LoadingQueue.pop();
 
 	return false;
@@ -45,6 +253,30 @@ void Renderer::unload()
 		UnloadTexture(s_Textures.back());
 		s_Textures.pop_back();
 	}
+
+	s_TextureStore.clear();
+	s_AssetPack.close();
+
+	if (s_FramebufferTexture.id != 0)
+	{
+		UnloadTexture(s_FramebufferTexture);
+		s_FramebufferTexture = {};
+	}
+}
+
+bool Renderer::exportFramebuffer(const std::string& path)
+{
+	if (s_Framebuffer.empty()) return false;
+
+	Image image{
+		s_Framebuffer.data(),
+		s_FramebufferWidth,
+		s_FramebufferHeight,
+		1,
+		PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+	};
+
+	return ExportImage(image, path.c_str());
 }
 
 TextureId Renderer::getNumericalId(const std::string& stringId)
@@ -55,6 +287,7 @@ TextureId Renderer::getNumericalId(const std::string& stringId)
 
 void Renderer::drawTexture(Rect rectangle, TextureId id, Col color)
 {
+	++s_CurrentStats.drawCalls;
 	DrawTexturePro(
 		s_Textures[id],
 		Rectangle{0.0f,0.0f,(float)s_Textures[id].width, (float)s_Textures[id].height},
@@ -65,8 +298,46 @@ void Renderer::drawTexture(Rect rectangle, TextureId id, Col color)
 	);
 }
 
+// x and columnWidth are in window pixels, a view column covers several of them below full resolution
+void drawCollumn(float x, float columnWidth, float lineHeight, TextureId id, float point, Col color = Colors::White)
+{
+	int32_t start = -lineHeight / 2 + Window::getHeight() / 2;
+	int32_t end = lineHeight / 2 + Window::getHeight() / 2;
+	float startWidth = (float)s_Textures[id].width * point;
+	Rectangle destination{ x, (float)start, columnWidth, (float)end - start + 1 };
+	++s_CurrentStats.drawCalls;
+
+	DrawTexturePro(
+		s_Textures[id],
+		Rectangle{ startWidth,0.0f,1.0f, (float)s_Textures[id].height },
+		destination,
+		{0.0f,0.0f},
+		0.0f,
+		toRay(color)
+	);
+}
+
+static void resizeFramebuffer(int32_t width, int32_t height)
+{
+	if (width == s_FramebufferWidth && height == s_FramebufferHeight) return;
+
+	s_FramebufferWidth = width;
+	s_FramebufferHeight = height;
+	s_Framebuffer.assign(width * height, Colors::Black);
+}
+
+static void fillFramebufferRows(int32_t startRow, int32_t endRow, Col color)
+{
+	std::fill(
+		s_Framebuffer.begin() + startRow * s_FramebufferWidth,
+		s_Framebuffer.begin() + endRow * s_FramebufferWidth,
+		color
+	);
+}
+
 static void drawCeiling(Col color)
 {
+	++s_CurrentStats.drawCalls;
 	DrawRectangle(
 		0,
 		0,
@@ -78,6 +349,7 @@ static void drawCeiling(Col color)
 
 static void drawFloor(Col color)
 {
+	++s_CurrentStats.drawCalls;
 	DrawRectangle(
 		0,
 		GetScreenHeight() / 2,
@@ -87,67 +359,698 @@ static void drawFloor(Col color)
 	);
 }
 
-void drawCollumn(int16_t index, float lineHeight, TextureId id, float point, bool darken, Col color = Colors::White)
+// Light is quantized to a colormap in the spirit of Doom's: every level has a
+// ramp scaling a channel value and a fog color amount added on top, so a texel
+// is shaded with three lookups. Visibility through the fog picks the fog amount
+// and caps the level, which keeps the sum of the two within a byte.
+static constexpr int32_t k_LightLevels = 32;
+// Walls facing along y keep the contrast the old darkening tint gave them
+static constexpr float k_SideLight = (255 - Colors::DarkTint.a) / 255.0f;
+
+static const auto s_LightRamps = []
 {
-	int32_t start = -lineHeight / 2 + Window::getHeight() / 2;
-	int32_t end = lineHeight / 2 + Window::getHeight() / 2;
-	float startWidth = (float)s_Textures[id].width * point;
-	Rectangle destination{ (float)index, (float)start, 1, (float)end - start + 1 };
+	std::array<std::array<uint8_t, 256>, k_LightLevels> ramps;
+	for (int32_t level = 0; level < k_LightLevels; ++level)
+	{
+		for (int32_t value = 0; value < 256; ++value)
+		{
+			ramps[level][value] = (uint8_t)((value * level + (k_LightLevels - 1) / 2) / (k_LightLevels - 1));
+		}
+	}
+	return ramps;
+}();
+
+static World::Lighting s_Lighting;
+static float s_FogScale = 0.0f;
+static std::vector<Col> s_FogAmounts(k_LightLevels, Colors::Black);
+
+struct Shade
+{
+	const uint8_t* ramp;
+	Col fog;
+};
+
+static void setLighting(const World::Lighting& lighting)
+{
+	s_Lighting = lighting;
+	s_FogScale = lighting.fogEnd > lighting.fogStart ? 1.0f / (lighting.fogEnd - lighting.fogStart) : 0.0f;
+
+	const Col fog = lighting.fogColor;
+	for (int32_t level = 0; level < k_LightLevels; ++level)
+	{
+		const int32_t amount = k_LightLevels - 1 - level;
+		s_FogAmounts[level] = Col(
+			fog.r * amount / (k_LightLevels - 1),
+			fog.g * amount / (k_LightLevels - 1),
+			fog.b * amount / (k_LightLevels - 1)
+		);
+	}
+}
+
+// How much of a surface shows through the fog at a perpendicular distance, as a light level
+static int32_t visibilityLevel(float distance)
+{
+	// Maps without fog leave both ends infinite, which must not reach the fog term as a NaN
+	if (!std::isfinite(s_Lighting.fogEnd)) return k_LightLevels - 1;
+	if (distance >= s_Lighting.fogEnd) return 0;
+	// A fog starting where it ends is a hard cut
+	if (s_FogScale == 0.0f) return k_LightLevels - 1;
+
+	const float visibility = std::clamp(1.0f - (distance - s_Lighting.fogStart) * s_FogScale, 0.0f, 1.0f);
+	return (int32_t)std::lround(visibility * (k_LightLevels - 1));
+}
+
+static Shade shadeAt(float light, int32_t visibility)
+{
+	const float lit = std::clamp(light * s_Lighting.ambient, 0.0f, 1.0f);
+	return { s_LightRamps[std::lround(lit * visibility)].data(), s_FogAmounts[visibility] };
+}
+
+static Col shadeTexel(Col texel, const Shade& shade)
+{
+	return Col(
+		shade.ramp[texel.r] + shade.fog.r,
+		shade.ramp[texel.g] + shade.fog.g,
+		shade.ramp[texel.b] + shade.fog.b,
+		texel.a
+	);
+}
 
+// raylib can only multiply, so the GPU draws fade to black instead of the fog color
+static Col shadeTint(const Shade& shade)
+{
+	return Col(shade.ramp[255], shade.ramp[255], shade.ramp[255]);
+}
+
+// Framebuffer rows a wall covers in each column, the floor and ceiling pass skips them
+struct WallSpan
+{
+	int32_t firstRow;
+	int32_t lastRow;
+};
+
+static std::vector<WallSpan> s_WallSpans;
+
+static void drawCollumnSoftware(int16_t index, float lineHeight, TextureId id, float point, const Shade& shade)
+{
+	int32_t start = -lineHeight / 2 + s_FramebufferHeight / 2;
+	int32_t end = lineHeight / 2 + s_FramebufferHeight / 2;
+	int32_t columnHeight = end - start + 1;
+
+	const int32_t level = s_TextureStore.selectLevel(id, columnHeight);
+	const auto& mip = s_TextureStore.level(id, level);
+
+	int32_t textureX = (int32_t)floorf((float)mip.width * point) % mip.width;
+	if (textureX < 0) textureX += mip.width;
+
+	const Col* texels = s_TextureStore.column(id, level, textureX);
+	int32_t firstRow = std::max(start, 0);
+	int32_t lastRow = std::min(end, s_FramebufferHeight - 1);
+	s_WallSpans[index] = { firstRow, lastRow };
+
+	// 16.16 fixed point walk down the texture column
+	const uint32_t textureStep = ((uint32_t)mip.height << 16) / columnHeight;
+	uint32_t textureY = (firstRow - start) * textureStep;
+	Col* pixel = &s_Framebuffer[firstRow * s_FramebufferWidth + index];
+
+	for (int32_t row = firstRow; row <= lastRow; ++row)
+	{
+		*pixel = shadeTexel(texels[textureY >> 16], shade);
+		pixel += s_FramebufferWidth;
+		textureY += textureStep;
+	}
+}
+
+// Columns of a floor row whose coordinates are computed in one go
+static constexpr size_t k_SpanLength = 64;
+
+struct FloorSpan
+{
+	alignas(32) int32_t cellX[k_SpanLength];
+	alignas(32) int32_t cellY[k_SpanLength];
+	// Position inside the cell, the texture coordinate
+	alignas(32) float u[k_SpanLength];
+	alignas(32) float v[k_SpanLength];
+};
+
+// The point of a floor row under column i is base + step * tangent[i], the
+// per column factor comes from the ray table so no pixel needs a divide
+static void floorSpanScalar(Vec2 base, Vec2 step, const float* tangent, size_t first, size_t end, FloorSpan& out)
+{
+	for (size_t i = first; i < end; ++i)
+	{
+		const float x = base.x + step.x * tangent[i];
+		const float y = base.y + step.y * tangent[i];
+		const float cellX = floorf(x);
+		const float cellY = floorf(y);
+
+		out.cellX[i] = (int32_t)cellX;
+		out.cellY[i] = (int32_t)cellY;
+		out.u[i] = x - cellX;
+		out.v[i] = y - cellY;
+	}
+}
+
+#if defined(OPAL_SIMD_X86)
+// Eight columns at a time with the same operations as floorSpanScalar
+OPAL_TARGET_AVX2
+static void floorSpanAvx2(Vec2 base, Vec2 step, const float* tangent, size_t count, FloorSpan& out)
+{
+	constexpr size_t k_Lanes = 8;
+
+	const __m256 baseX = _mm256_set1_ps(base.x);
+	const __m256 baseY = _mm256_set1_ps(base.y);
+	const __m256 stepX = _mm256_set1_ps(step.x);
+	const __m256 stepY = _mm256_set1_ps(step.y);
+
+	size_t i = 0;
+	for (; i + k_Lanes <= count; i += k_Lanes)
+	{
+		const __m256 factor = _mm256_loadu_ps(tangent + i);
+		const __m256 x = _mm256_add_ps(baseX, _mm256_mul_ps(stepX, factor));
+		const __m256 y = _mm256_add_ps(baseY, _mm256_mul_ps(stepY, factor));
+		const __m256 cellX = _mm256_floor_ps(x);
+		const __m256 cellY = _mm256_floor_ps(y);
+
+		_mm256_store_si256(reinterpret_cast<__m256i*>(out.cellX + i), _mm256_cvttps_epi32(cellX));
+		_mm256_store_si256(reinterpret_cast<__m256i*>(out.cellY + i), _mm256_cvttps_epi32(cellY));
+		_mm256_store_ps(out.u + i, _mm256_sub_ps(x, cellX));
+		_mm256_store_ps(out.v + i, _mm256_sub_ps(y, cellY));
+	}
+
+	_mm256_zeroupper();
+	floorSpanScalar(base, step, tangent, i, count, out);
+}
+#endif
+
+static void floorSpan(Vec2 base, Vec2 step, const float* tangent, size_t count, FloorSpan& out)
+{
+#if defined(OPAL_SIMD_X86)
+	if (Simd::avx2Enabled())
+	{
+		floorSpanAvx2(base, step, tangent, count, out);
+		return;
+	}
+#endif
+
+	floorSpanScalar(base, step, tangent, 0, count, out);
+}
+
+static Col sampleSurface(TextureId id, int32_t level, float u, float v)
+{
+	const auto& mip = s_TextureStore.level(id, level);
+	// A coordinate a hair below a cell edge can round up to 1
+	const int32_t textureX = std::min((int32_t)(u * mip.width), mip.width - 1);
+	const int32_t textureY = std::min((int32_t)(v * mip.height), mip.height - 1);
+	return s_TextureStore.column(id, level, textureX)[textureY];
+}
+
+// Row band i holds floor row horizon + i and ceiling row horizon - 1 - i, which
+// look at the same floor point in every column. Surfaces without a texture
+// keep the flat colors, lit like textured ones.
+static void castFloorRows(const World& level, Vec2 origin, Vec2 view, const World::ColumnRays& rays, size_t firstBand, size_t endBand)
+{
+	const int32_t width = s_FramebufferWidth;
+	const int32_t horizon = s_FramebufferHeight / 2;
+	const Tile empty;
+	FloorSpan span;
+
+	for (size_t band = firstBand; band < endBand; ++band)
+	{
+		const int32_t floorRow = horizon + (int32_t)band;
+		const int32_t ceilingRow = horizon - 1 - (int32_t)band;
+		// Perpendicular distance to the floor seen through the centers of the two rows
+		const int32_t projectedCell = 2 * (int32_t)band + 1;
+		const float distance = (float)s_FramebufferHeight / (float)projectedCell;
+		const Vec2 base = origin + view * distance;
+		const Vec2 step(-view.y * distance, view.x * distance);
+		const int32_t visibility = visibilityLevel(distance);
+
+		Col* floorPixels = &s_Framebuffer[(size_t)floorRow * width];
+		Col* ceilingPixels = ceilingRow >= 0 ? &s_Framebuffer[(size_t)ceilingRow * width] : nullptr;
+
+		for (int32_t first = 0; first < width; first += (int32_t)k_SpanLength)
+		{
+			const size_t count = std::min<size_t>(k_SpanLength, width - first);
+			floorSpan(base, step, rays.tangent.data() + first, count, span);
+
+			// Neighbouring pixels mostly share a cell, so its textures are only looked up on a change
+			Vec2i cell{ INT32_MIN, INT32_MIN };
+			TextureId floorId = Renderer::NO_TEXTURE;
+			TextureId ceilingId = Renderer::NO_TEXTURE;
+			int32_t floorLevel = 0;
+			int32_t ceilingLevel = 0;
+			float shadeLight = 1.0f;
+			Shade shade = shadeAt(1.0f, visibility);
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				const int32_t column = first + (int32_t)i;
+				const WallSpan wall = s_WallSpans[column];
+				const bool floorVisible = floorRow > wall.lastRow;
+				const bool ceilingVisible = ceilingPixels && ceilingRow < wall.firstRow;
+				if (!floorVisible && !ceilingVisible) continue;
+
+				if (span.cellX[i] != cell.x || span.cellY[i] != cell.y)
+				{
+					cell = { span.cellX[i], span.cellY[i] };
+					const Tile& tile = level.contains(cell) ? level.tile(cell) : empty;
+					floorId = tile.floorTextureId();
+					ceilingId = tile.ceilingTextureId();
+					if (floorId != Renderer::NO_TEXTURE) floorLevel = s_TextureStore.selectLevel(floorId, projectedCell);
+					if (ceilingId != Renderer::NO_TEXTURE) ceilingLevel = s_TextureStore.selectLevel(ceilingId, projectedCell);
+					if (tile.light() != shadeLight)
+					{
+						shadeLight = tile.light();
+						shade = shadeAt(shadeLight, visibility);
+					}
+				}
+
+				if (floorVisible)
+				{
+					floorPixels[column] = shadeTexel(floorId == Renderer::NO_TEXTURE ?
+						Colors::LightGray : sampleSurface(floorId, floorLevel, span.u[i], span.v[i]), shade);
+				}
+
+				if (ceilingVisible)
+				{
+					ceilingPixels[column] = shadeTexel(ceilingId == Renderer::NO_TEXTURE ?
+						Colors::Gray : sampleSurface(ceilingId, ceilingLevel, span.u[i], span.v[i]), shade);
+				}
+			}
+		}
+	}
+}
+
+void presentFramebuffer()
+{
+	if (s_FramebufferTexture.width != s_FramebufferWidth ||
+		s_FramebufferTexture.height != s_FramebufferHeight)
+	{
+		if (s_FramebufferTexture.id != 0) UnloadTexture(s_FramebufferTexture);
+
+		Image image{
+			s_Framebuffer.data(),
+			s_FramebufferWidth,
+			s_FramebufferHeight,
+			1,
+			PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+		};
+		s_FramebufferTexture = LoadTextureFromImage(image);
+	}
+	else
+	{
+		UpdateTexture(s_FramebufferTexture, s_Framebuffer.data());
+	}
+
+	// The framebuffer has a column per ray, stretched over the whole window
 	DrawTexturePro(
-		s_Textures[id],
-		Rectangle{ startWidth,0.0f,1.0f, (float)s_Textures[id].height },
-		destination,
-		{0.0f,0.0f},
+		s_FramebufferTexture,
+		Rectangle{ 0.0f, 0.0f, (float)s_FramebufferWidth, (float)s_FramebufferHeight },
+		Rectangle{ 0.0f, 0.0f, (float)Window::getWidth(), (float)Window::getHeight() },
+		{ 0.0f, 0.0f },
 		0.0f,
-		toRay(color)
+		WHITE
 	);
+}
 
-	if (darken)
+constexpr float k_Fov = std::numbers::pi / 180.0f * 90.0f;
+
+static constexpr size_t k_ColumnGrain = 64;
+static constexpr size_t k_RowGrain = 16;
+static World::ColumnRays s_Rays;
+static World::RaycastColumns s_Columns;
+
+static Shade wallShade(size_t column, float depth, bool sideways)
+{
+	return shadeAt(s_Columns.light[column] * (sideways ? k_SideLight : 1.0f), visibilityLevel(depth));
+}
+
+// Sprites closer than this would project larger than any sensible column
+static constexpr float k_SpriteNearPlane = 0.2f;
+// Sprites are sorted out against the farthest wall of each block of this many columns
+static constexpr size_t k_DepthBlock = 64;
+
+struct VisibleSprite
+{
+	Entity entity;
+	TextureId texture;
+	int32_t level;
+	float depth;
+	// Lit by the cell the sprite stands in
+	Shade shade;
+	// Column the left edge projects to and how many columns the sprite spans
+	float left;
+	float width;
+	int32_t top;
+	int32_t height;
+	int32_t firstColumn;
+	int32_t lastColumn;
+};
+
+// Perpendicular distance to the wall of every column, infinite where no wall was hit
+static std::vector<float> s_Depth;
+static std::vector<float> s_DepthBlocks;
+static std::vector<VisibleSprite> s_Sprites;
+
+static void buildDepthBlocks()
+{
+	s_DepthBlocks.assign((s_Depth.size() + k_DepthBlock - 1) / k_DepthBlock, 0.0f);
+
+	for (size_t column = 0; column < s_Depth.size(); ++column)
 	{
-		DrawRectanglePro(
-			destination,
-			{0.0f,0.0f},
-			0.0f,
-			toRay(Colors::DarkTint)
-		);
+		float& farthest = s_DepthBlocks[column / k_DepthBlock];
+		farthest = std::max(farthest, s_Depth[column]);
 	}
 }
 
-constexpr float k_Fov = std::numbers::pi / 180.0f * 90.0f;
+// Projects every sprite in front of the camera, drops the ones off screen or
+// behind the walls of every column they cover, and sorts the rest back to front
+static void collectSprites(GameContext& context, Entity cameraEntity, Vec2 position, Vec2 view)
+{
+	OPAL_PROFILE_SCOPE("Renderer::collectSprites");
+
+	const int32_t columns = s_FramebufferWidth;
+	const int32_t height = s_FramebufferHeight;
+	const float columnsPerRadian = (float)columns / k_Fov;
+	const Vec2 side(-view.y, view.x);
+
+	s_Sprites.clear();
+	s_Sprites.reserve(context.entities.getSet<Comp::Sprite>().size());
+
+	context.entities.view<Comp::Transform, Comp::Sprite>().each([&](Entity entity, auto, const Comp::Sprite& sprite)
+	{
+		if (entity == cameraEntity || sprite.texture == Renderer::NO_TEXTURE) return;
+
+		const Vec2 offset = Systems::interpolatedTransform(context, entity).position - position;
+		const float depth = offset.x * view.x + offset.y * view.y;
+		if (depth < k_SpriteNearPlane || depth > World::k_ViewDistance) return;
+
+		// Columns are spread by angle, so the center goes through atan2 once per sprite
+		const float lateral = offset.x * side.x + offset.y * side.y;
+		const float center = (atan2f(lateral, depth) + k_Fov * 0.5f) * columnsPerRadian;
+		const float width = sprite.size / depth * columnsPerRadian;
+		const float left = center - width * 0.5f;
+		const int32_t firstColumn = std::max((int32_t)floorf(left), 0);
+		const int32_t lastColumn = std::min((int32_t)ceilf(left + width) - 1, columns - 1);
+		if (firstColumn > lastColumn) return;
+
+		bool visible = false;
+		for (size_t block = firstColumn / k_DepthBlock; block <= lastColumn / k_DepthBlock && !visible; ++block)
+		{
+			visible = depth < s_DepthBlocks[block];
+		}
+
+		if (!visible) return;
 
-void Systems::displayView(GameContext& context, size_t entityId)
+		// Standing on the floor, a size 1 sprite is exactly as tall as a wall at that depth
+		const int32_t spriteHeight = std::max((int32_t)(sprite.size * height / depth), 1);
+		const int32_t bottom = height / 2 + (int32_t)(height / depth * 0.5f);
+		const Vec2i cell{ (int32_t)floorf(position.x + offset.x), (int32_t)floorf(position.y + offset.y) };
+		const float light = context.level.contains(cell) ? context.level.tile(cell).light() : 1.0f;
+
+		s_Sprites.push_back({
+			entity,
+			sprite.texture,
+			s_TextureStore.selectLevel(sprite.texture, spriteHeight),
+			depth,
+			shadeAt(light, visibilityLevel(depth)),
+			left,
+			width,
+			bottom - spriteHeight,
+			spriteHeight,
+			firstColumn,
+			lastColumn
+		});
+	});
+
+	// Ties broken by handle, so the order does not depend on the set layout
+	std::sort(s_Sprites.begin(), s_Sprites.end(), [](const VisibleSprite& a, const VisibleSprite& b)
+	{
+		return a.depth != b.depth ? a.depth > b.depth : a.entity < b.entity;
+	});
+
+	s_CurrentStats.spritesDrawn += s_Sprites.size();
+}
+
+// Draws the parts of every visible sprite inside columns [begin, end), back to
+// front, skipping columns whose wall is closer. Texels with low alpha are cut out.
+static void drawSpritesSoftware(size_t begin, size_t end)
 {
+	for (const VisibleSprite& sprite : s_Sprites)
+	{
+		const int32_t first = std::max(sprite.firstColumn, (int32_t)begin);
+		const int32_t last = std::min(sprite.lastColumn, (int32_t)end - 1);
+		if (first > last) continue;
+
+		const auto& mip = s_TextureStore.level(sprite.texture, sprite.level);
+		const float texelsPerColumn = (float)mip.width / sprite.width;
+		const int32_t firstRow = std::max(sprite.top, 0);
+		const int32_t lastRow = std::min(sprite.top + sprite.height - 1, s_FramebufferHeight - 1);
+		const uint32_t textureStep = ((uint32_t)mip.height << 16) / sprite.height;
+
+		for (int32_t column = first; column <= last; ++column)
+		{
+			if (sprite.depth >= s_Depth[column]) continue;
+
+			const int32_t textureX = std::clamp((int32_t)((column + 0.5f - sprite.left) * texelsPerColumn), 0, mip.width - 1);
+			const Col* texels = s_TextureStore.column(sprite.texture, sprite.level, textureX);
+			uint32_t textureY = (firstRow - sprite.top) * textureStep;
+			Col* pixel = &s_Framebuffer[(size_t)firstRow * s_FramebufferWidth + column];
+
+			for (int32_t row = firstRow; row <= lastRow; ++row)
+			{
+				const Col texel = texels[textureY >> 16];
+				if (texel.a >= 128) *pixel = shadeTexel(texel, sprite.shade);
+				pixel += s_FramebufferWidth;
+				textureY += textureStep;
+			}
+		}
+	}
+}
+
+// One draw per run of columns where the sprite is in front of the walls
+static void drawSpritesGpu(float columnWidth)
+{
+	for (const VisibleSprite& sprite : s_Sprites)
+	{
+		const Texture& texture = s_Textures[sprite.texture];
+		const float texelsPerColumn = (float)texture.width / sprite.width;
+
+		for (int32_t column = sprite.firstColumn; column <= sprite.lastColumn;)
+		{
+			if (sprite.depth >= s_Depth[column])
+			{
+				++column;
+				continue;
+			}
+
+			const int32_t runStart = column;
+			while (column <= sprite.lastColumn && sprite.depth < s_Depth[column]) ++column;
+
+			// The first and last run are cut at the sprite edges rather than the column edges
+			const float runLeft = std::max((float)runStart, sprite.left);
+			const float runRight = std::min((float)column, sprite.left + sprite.width);
+
+			++s_CurrentStats.drawCalls;
+			DrawTexturePro(
+				texture,
+				Rectangle{ (runLeft - sprite.left) * texelsPerColumn, 0.0f, (runRight - runLeft) * texelsPerColumn, (float)texture.height },
+				Rectangle{ runLeft * columnWidth, (float)sprite.top, (runRight - runLeft) * columnWidth, (float)sprite.height },
+				{ 0.0f, 0.0f },
+				0.0f,
+				toRay(shadeTint(sprite.shade))
+			);
+		}
+	}
+}
+
+void Systems::displayView(GameContext& context, Entity entityId)
+{
+	OPAL_PROFILE_SCOPE("Systems::displayView");
+	Memory::Tag tag(Memory::Subsystem::Rendering);
+
 	const int32_t width = Window::getWidth();
 	const int32_t height = Window::getHeight();
+	// One ray per view column, the view is stretched to the window width
+	const int32_t columns = std::clamp((int32_t)std::lround(width * s_ResolutionScale), 1, std::max(width, 1));
 
-	auto playerTransform = context.entities.get<Comp::Transform>(entityId);;
+	Comp::Transform playerTransform = Systems::interpolatedTransform(context, entityId);
 	auto position = playerTransform.position;
 	auto angle = playerTransform.angle;
-	const float angleIncrement = k_Fov / (float)width;
-	float angleStart = angle - (k_Fov * 0.5f);
 
-	drawCeiling(Colors::Gray);
-	drawFloor(Colors::LightGray);
+	s_Rays.build(columns, k_Fov);
+	setLighting(context.level.lighting());
+
+	const bool software = s_RenderMode == Renderer::RenderMode::Software;
+
+	// Cast floors and ceilings go through the framebuffer in both modes, the GPU draws the walls over them
+	if (software || s_FloorCasting)
+	{
+		resizeFramebuffer(columns, height);
+		s_FramebufferDrawn = true;
+	}
+
+	if (software && !s_FloorCasting)
+	{
+		fillFramebufferRows(0, height / 2, Colors::Gray);
+		fillFramebufferRows(height / 2, height, Colors::LightGray);
+	}
+
+	auto lineHeightAt = [&](size_t column)
+	{
+		float perpendicularDistance = s_Columns.distance[column] * s_Rays.cosine[column];
+		return (int32_t)(height / perpendicularDistance);
+	};
+
+	s_Columns.resize(columns);
+	s_Depth.resize(columns);
+	s_WallSpans.assign(columns, { height, -1 });
+	s_CurrentStats.raysCast += columns;
+	s_CurrentStats.resolutionScale = s_ResolutionScale;
+
+	Jobs::parallelFor(0, columns, k_ColumnGrain, [&](size_t begin, size_t end)
+	{
+		context.level.raycastColumns(position, angle, s_Rays, begin, end - begin, s_Columns);
+
+		for (size_t column = begin; column < end; ++column)
+		{
+			s_Depth[column] = s_Columns.hit[column] ?
+				s_Columns.distance[column] * s_Rays.cosine[column] : std::numeric_limits<float>::infinity();
+		}
+
+		if (!software) return;
+
+		for (size_t column = begin; column < end; ++column)
+		{
+			if (!s_Columns.hit[column]) continue;
+
+			drawCollumnSoftware(
+				column,
+				lineHeightAt(column),
+				s_Columns.textureId[column],
+				s_Columns.point[column],
+				wallShade(column, s_Depth[column], s_Columns.sideways[column])
+			);
+		}
+	});
+
+	// Bands come in pairs of a floor and a ceiling row, so an odd height has one floor row more
+	const Vec2 view = Vec2::direction(angle);
+	if (s_FloorCasting)
+	{
+		Jobs::parallelFor(0, height - height / 2, k_RowGrain, [&](size_t begin, size_t end)
+		{
+			castFloorRows(context.level, position, view, s_Rays, begin, end);
+		});
+	}
+
+	buildDepthBlocks();
+	collectSprites(context, entityId, position, view);
 
-	for (size_t column = 0; column < width; ++column)
+	if (software)
 	{
-		float rayAngle = angleStart + column * angleIncrement;
-		Vec2 direction = Vec2::direction(rayAngle);
+		if (s_Sprites.empty()) return;
 
-		auto hit = context.level.raycast(position, direction);
+		Jobs::parallelFor(0, columns, k_ColumnGrain, [](size_t begin, size_t end)
+		{
+			drawSpritesSoftware(begin, end);
+		});
 
-		if (!hit) continue;
+		return;
+	}
 
-		float perpendicularDistance = hit.value().distance * cosf(rayAngle - angle);
-		int32_t lineHeight = (int)(height / perpendicularDistance);
+	// raylib can only be driven from the main thread
+	flushFramebuffer();
+
+	if (!s_FloorCasting)
+	{
+		drawCeiling(Colors::Gray);
+		drawFloor(Colors::LightGray);
+	}
+
+	const float columnWidth = (float)width / (float)columns;
+	for (size_t column = 0; column < columns; ++column)
+	{
+		if (!s_Columns.hit[column]) continue;
 
 		drawCollumn(
-			column,
-			lineHeight,
-			hit.value().textureId,
-			hit.value().point,
-			hit.value().sideways
+			column * columnWidth,
+			columnWidth,
+			lineHeightAt(column),
+			s_Columns.textureId[column],
+			s_Columns.point[column],
+			shadeTint(wallShade(column, s_Depth[column], s_Columns.sideways[column]))
 		);
 	}
-}
\ No newline at end of file
+
+	drawSpritesGpu(columnWidth);
+}
+
+void Renderer::drawProfilerOverlay()
+{
+	if (Window::isHeadless()) return;
+
+	// The software frame goes first, it would cover the overlay otherwise
+	flushFramebuffer();
+
+	constexpr int32_t k_Margin = 8;
+	constexpr int32_t k_FontSize = 10;
+	constexpr int32_t k_RowHeight = 12;
+	constexpr int32_t k_GraphHeight = 60;
+	// The graph tops out at two 60 Hz frames
+	constexpr float k_GraphMilliseconds = 1000.0f / 30.0f;
+
+	constexpr size_t k_Subsystems = (size_t)Memory::Subsystem::Count;
+
+	const auto& timings = Profiler::timings();
+	const auto& frameTimes = Profiler::frameTimes();
+	const int32_t width = 2 * k_Margin + (int32_t)Profiler::k_FrameHistory;
+	const int32_t rows = (int32_t)(timings.size() + k_Subsystems + 3);
+	const int32_t height = 3 * k_Margin + rows * k_RowHeight + k_GraphHeight;
+
+	++s_CurrentStats.drawCalls;
+	DrawRectangle(0, 0, width, height, toRay(Col(0, 0, 0, 180)));
+
+	const float frameTime = frameTimes.empty() ? 0.0f : frameTimes.back();
+	int32_t y = k_Margin;
+	++s_CurrentStats.drawCalls;
+	DrawText(TextFormat("frame %6.2f ms", frameTime), k_Margin, y, k_FontSize, toRay(Colors::White));
+
+	y += k_RowHeight;
+	++s_CurrentStats.drawCalls;
+	DrawText(TextFormat("resolution %3d%% %5zu columns", (int32_t)std::lround(s_ResolutionScale * 100.0f), s_Columns.size()), k_Margin, y, k_FontSize, toRay(Colors::White));
+
+	for (const Profiler::Timing& timing : timings)
+	{
+		y += k_RowHeight;
+		++s_CurrentStats.drawCalls;
+		DrawText(TextFormat("%-24s %6.2f ms", timing.name, timing.milliseconds), k_Margin, y, k_FontSize, toRay(Colors::White));
+	}
+
+	// Heap use of the previous frame, anything but zero is worth a look
+	for (size_t i = 0; i < k_Subsystems; ++i)
+	{
+		const Memory::Counters counters = Memory::lastFrame((Memory::Subsystem)i);
+		y += k_RowHeight;
+		++s_CurrentStats.drawCalls;
+		DrawText(
+			TextFormat("heap %-19s %4llu allocs %6llu B", Memory::name((Memory::Subsystem)i), (unsigned long long)counters.allocations, (unsigned long long)counters.bytes),
+			k_Margin, y, k_FontSize, toRay(counters.allocations ? Colors::Red : Colors::White)
+		);
+	}
+
+	y += k_RowHeight;
+	++s_CurrentStats.drawCalls;
+	DrawText(TextFormat("frame arena %zu / %zu KB", Memory::frameArena().used() >> 10, Memory::frameArena().capacity() >> 10), k_Margin, y, k_FontSize, toRay(Colors::White));
+
+	// One bar per frame, red once it misses 60 Hz
+	const int32_t graphBottom = height - k_Margin;
+	for (size_t i = 0; i < frameTimes.size(); ++i)
+	{
+		const int32_t barHeight = (int32_t)(std::min(frameTimes[i] / k_GraphMilliseconds, 1.0f) * k_GraphHeight);
+		const Col color = frameTimes[i] > 1000.0f / 60.0f ? Colors::Red : Colors::Green;
+		++s_CurrentStats.drawCalls;
+		DrawRectangle(k_Margin + (int32_t)i, graphBottom - barHeight, 1, barHeight, toRay(color));
+	}
+}
@@ -10,13 +10,55 @@ namespace Renderer
 {
 	constexpr TextureId NO_TEXTURE = -1;
 
+	enum class RenderMode
+	{
+		Gpu,
+		Software
+	};
+
+	void setRenderMode(RenderMode mode);
+	RenderMode getRenderMode();
+
+	// Floors and ceilings are textured on the CPU in either mode. Turned off they are flat
+	// colors, which the GPU mode draws itself without touching the CPU framebuffer.
+	void setFloorCasting(bool enabled);
+	bool getFloorCasting();
+
+	constexpr float k_MinResolutionScale = 0.25f;
+
+	// Share of the window width the view casts rays for, the view is stretched to the window
+	void setResolutionScale(float scale);
+	float getResolutionScale();
+	// Adjusts the resolution scale after every frame to render it within seconds, 0 keeps the scale fixed
+	void setTargetFrameTime(float seconds);
+
+	struct FrameStats
+	{
+		size_t drawCalls = 0;
+		size_t raysCast = 0;
+		// Sprites left after culling
+		size_t spritesDrawn = 0;
+		// Scale the view of the frame was rendered at
+		float resolutionScale = 1.0f;
+	};
+
+	// Counters of the last frame finished with endDrawing
+	const FrameStats& getFrameStats();
+	// The software framebuffer at the resolution it was rendered, before stretching to the window
+	bool exportFramebuffer(const std::string& path);
+
 	void beginDrawing();
 	void endDrawing();
 	void clearBackground(Col color = Colors::Black);
 
+	// Decodes every image on the job system, call loadTexturesFromImages afterwards to upload them
 	void loadImages(const nlohmann::json& mapping);
+	// Maps a .opalpack written by opal_packc, its pixels are uploaded straight from the file
+	bool loadAssetPack(const std::string& path);
 	bool loadTexturesFromImages();
 	void unload();
 	TextureId getNumericalId(const std::string& stringId);
 	void drawTexture(Rect rectangle, TextureId id, Col color = Colors::White);
+	// Per system timings, the frame time graph and the heap use of the last frame, on top of the frame drawn so far
+	void drawProfilerOverlay();
 }
\ No newline at end of file
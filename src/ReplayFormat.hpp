@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Layout of the input recordings written by --record. Everything is little
+// endian. The map path follows the header, then every tick is stored as a
+// uint32_t frame count, that many FrameRecords and the uint64_t hash of every
+// Transform once the tick ran.
+namespace ReplayFormat
+{
+	constexpr char k_Magic[8] = { 'O', 'P', 'A', 'L', 'R', 'E', 'C', '\0' };
+	constexpr uint32_t k_Version = 1;
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t tickRate;
+		// Chunks outside the budget read as empty, so it changes collisions too
+		uint64_t worldMemoryBudget;
+		uint32_t mapPathLength;
+		// Sprites own transforms too, so they are part of every hash. Was reserved and zero before.
+		uint32_t spriteCount;
+	};
+
+	struct FrameRecord
+	{
+		uint32_t entity;
+		float look;
+		uint8_t buttons;
+		uint8_t reserved[3];
+	};
+}
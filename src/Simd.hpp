@@ -0,0 +1,38 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define OPAL_SIMD_X86
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define OPAL_TARGET_AVX2
+	#else
+		#define OPAL_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+namespace Simd
+{
+	inline bool detectAvx2()
+	{
+#if !defined(OPAL_SIMD_X86)
+		return false;
+#elif defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+		bool hasAvx = info[2] & (1 << 28);
+		__cpuidex(info, 7, 0);
+		return osSavesYmm && hasAvx && (info[1] & (1 << 5));
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	inline bool s_Avx2Enabled = detectAvx2();
+
+	// Lets benchmarks and debugging force the scalar paths on capable machines
+	inline void setAvx2Enabled(bool enabled) { s_Avx2Enabled = enabled && detectAvx2(); }
+	inline bool avx2Enabled() { return s_Avx2Enabled; }
+}
\ No newline at end of file
@@ -1,101 +1,216 @@
 #pragma once
 
 #include <vector>
-#include <limits>
+#include <array>
 #include <algorithm>
 #include <utility>
 #include <cassert>
+#include "Entity.hpp"
+#include "ComponentStorage.hpp"
+#include "Memory.hpp"
 
-template <typename T, size_t CAPACITY>
+constexpr uint32_t k_SparsePageShift = 12;
+
+// Sparse pages of every set share one pool, so sets that are destroyed hand their
+// pages to the next ones. Never destroyed, sets in static storage release pages
+// during exit.
+inline Memory::BlockPool& sparsePagePool()
+{
+	static Memory::BlockPool& pool = *new Memory::BlockPool((1u << k_SparsePageShift) * sizeof(Entity), 16);
+	return pool;
+}
+
+template <typename T, typename Storage = AosStorage<T>>
 class SparseSet
 {
 public:
-	SparseSet() : m_Sparse(CAPACITY, k_Empty)
+
+	using Value = T;
+
+	// T& for the default storage, a proxy of field references for SoaStorage
+	using Reference = typename Storage::Reference;
+	using ConstReference = typename Storage::ConstReference;
+
+	// Sparse entries are allocated a page at a time, only around the indices in use
+	static constexpr uint32_t k_PageShift = k_SparsePageShift;
+	static constexpr uint32_t k_PageSize = 1u << k_PageShift;
+	static constexpr uint32_t k_PageCount = (Handle::k_IndexMask >> k_PageShift) + 1;
+
+	SparseSet()
+	{
+		m_Pages.fill(const_cast<Entity*>(k_NullPage.data()));
+	}
+
+	~SparseSet()
 	{
-		m_Dense.reserve(CAPACITY);
-		m_Data.reserve(CAPACITY);
+		for (Entity* page : m_Pages)
+		{
+			if (page != k_NullPage.data()) sparsePagePool().deallocate(page);
+		}
 	}
 
-	void insert(size_t index, const T& item)
+	SparseSet(const SparseSet&) = delete;
+	SparseSet& operator=(const SparseSet&) = delete;
+
+	void reserve(size_t capacity)
 	{
-		assert(index < CAPACITY);
-		assert(m_Sparse[index] == k_Empty);
+		m_Dense.reserve(capacity);
+		m_Data.reserve(capacity);
+	}
 
-		m_Data.push_back(item);
-		m_Dense.push_back(index);
-		m_Sparse[index] = m_Data.size() - 1;
+	void insert(Entity entity, const T& item)
+	{
+		emplace(entity, item);
 	}
 
 	template <typename ... Args>
-	void emplace(size_t index, Args&&... args)
+	void emplace(Entity entity, Args&&... args)
 	{
-		assert(index < CAPACITY);
-		assert(m_Sparse[index] == k_Empty);
+		Entity& slot = sparseSlot(Handle::index(entity));
+		assert(slot == Handle::k_Null);
 
-		m_Data.emplace_back(std::forward<Args>(args)...);
-		m_Dense.push_back(index);
-		m_Sparse[index] = m_Data.size() - 1;
+		m_Data.emplaceBack(std::forward<Args>(args)...);
+		m_Dense.push_back(entity);
+		slot = Handle::make((uint32_t)m_Dense.size() - 1, Handle::generation(entity));
 	}
 
-	bool contains(size_t index) const
+	// Only matches the exact handle, a stale one with an older generation is absent
+	bool contains(Entity entity) const
 	{
-		return m_Sparse[index] != k_Empty;
+		const Entity slot = sparseEntry(Handle::index(entity));
+		return slot != Handle::k_Null && Handle::generation(slot) == Handle::generation(entity);
 	}
 
-	void pop(size_t index)
+	void pop(Entity entity)
 	{
-		assert(index < CAPACITY);
+		assert(contains(entity));
 
-		const size_t denseIndex = m_Sparse[index];
+		const uint32_t denseIndex = Handle::index(sparseEntry(Handle::index(entity)));
+		const uint32_t lastDenseIndex = (uint32_t)m_Dense.size() - 1;
 
-		if (denseIndex == m_Data.size() - 1)
+		if (denseIndex != lastDenseIndex)
 		{
-			m_Sparse[index] = k_Empty;
-			m_Dense.pop_back();
-			m_Data.pop_back();
-			return;
+			const Entity last = m_Dense[lastDenseIndex];
+
+			m_Data.swap(denseIndex, lastDenseIndex);
+			m_Dense[denseIndex] = last;
+			sparseSlot(Handle::index(last)) = Handle::make(denseIndex, Handle::generation(last));
 		}
 
-		const size_t lastDenseIndex = m_Data.size() - 1;
-		const size_t lastSparseIndex = m_Dense[lastDenseIndex];
+		m_Data.popBack();
+		m_Dense.pop_back();
+		sparseSlot(Handle::index(entity)) = Handle::k_Null;
+	}
 
-		std::swap(m_Data[denseIndex], m_Data.back());
+	bool popIfContains(Entity entity)
+	{
+		if (!contains(entity)) return false;
 
-		m_Dense[denseIndex] = lastSparseIndex;
-		m_Sparse[lastSparseIndex] = denseIndex;
+		pop(entity);
+		return true;
+	}
 
-		m_Data.pop_back();
-		m_Dense.pop_back();
-		m_Sparse[index] = k_Empty;
+	// Appends every item, meant for entities sorted by index so the sparse
+	// pages get written in order. None of them may be in the set yet.
+	template <typename Items>
+	void insertBulk(Items&& items)
+	{
+		for (auto&& [entity, item] : items)
+		{
+			emplace(entity, std::move(item));
+		}
 	}
 
-	bool popIfContains(size_t index)
+	// Erases every listed entity that is in the set with a single compacting
+	// pass over the dense arrays instead of a swap and pop per entity. The
+	// survivors keep their relative order.
+	void eraseBulk(const std::vector<Entity>& entities)
 	{
-		if (!contains(index)) return false;
+		size_t first = m_Dense.size();
 
-		pop(index);
-		return true;
+		for (Entity entity : entities)
+		{
+			if (!contains(entity)) continue;
+
+			first = std::min(first, denseIndex(entity));
+			sparseSlot(Handle::index(entity)) = Handle::k_Null;
+		}
+
+		if (first == m_Dense.size()) return;
+
+		size_t write = first;
+		for (size_t read = first; read < m_Dense.size(); ++read)
+		{
+			const Entity entity = m_Dense[read];
+			if (sparseEntry(Handle::index(entity)) == Handle::k_Null) continue;
+
+			m_Data.move(read, write);
+			m_Dense[write] = entity;
+			sparseSlot(Handle::index(entity)) = Handle::make((uint32_t)write, Handle::generation(entity));
+			++write;
+		}
+
+		m_Data.truncate(write);
+		m_Dense.resize(write);
 	}
 
-	const T& at(size_t index) const
+	ConstReference at(Entity entity) const
 	{
-		assert(index < CAPACITY);
-		return m_Data[m_Sparse[index]];
+		assert(contains(entity));
+		return m_Data[denseIndex(entity)];
 	}
 
-	T& operator[](size_t index)
+	Reference operator[](Entity entity)
 	{
-		return m_Data[m_Sparse[index]];
+		return m_Data[denseIndex(entity)];
 	}
 
 	bool empty() const
 	{
-		return m_Data.empty();
+		return m_Data.size() == 0;
 	}
 
+	size_t size() const
+	{
+		return m_Data.size();
+	}
+
+	size_t denseIndex(Entity entity) const
+	{
+		return Handle::index(sparseEntry(Handle::index(entity)));
+	}
+
+	// Dense entries in iteration order, the handles and the items line up
+	const std::vector<Entity>& indices() const
+	{
+		return m_Dense;
+	}
+
+	// T* for the default storage, the column pointers for SoaStorage
+	auto data()
+	{
+		return m_Data.data();
+	}
+
+	// Swaps two dense positions while keeping every handle pointing at its item
+	void swapDense(size_t first, size_t second)
+	{
+		if (first == second) return;
+
+		m_Data.swap(first, second);
+		std::swap(m_Dense[first], m_Dense[second]);
+		sparseSlot(Handle::index(m_Dense[first])) = Handle::make((uint32_t)first, Handle::generation(m_Dense[first]));
+		sparseSlot(Handle::index(m_Dense[second])) = Handle::make((uint32_t)second, Handle::generation(m_Dense[second]));
+	}
+
+	// Keeps the allocated pages around, refilling is the common case after a clear
 	void clear()
 	{
-		m_Sparse.assign(CAPACITY, k_Empty);
+		for (Entity entity : m_Dense)
+		{
+			sparseSlot(Handle::index(entity)) = Handle::k_Null;
+		}
+
 		m_Dense.clear();
 		m_Data.clear();
 	}
@@ -111,12 +226,12 @@ public:
 			return m_Index;
 		}
 
-		T& data() const
+		Reference data() const
 		{
 			return m_Set->m_Data[m_Index];
 		}
 
-		std::pair<size_t, T&> operator*() const
+		std::pair<Entity, Reference> operator*() const
 		{
 			return { m_Set->m_Dense[m_Index], m_Set->m_Data[m_Index] };
 		}
@@ -141,7 +256,7 @@ public:
 
 		friend SparseSet;
 		size_t m_Index;
-		SparseSet<T, CAPACITY>* m_Set;
+		SparseSet* m_Set;
 	};
 
 	Iterator begin()
@@ -154,15 +269,49 @@ public:
 		return Iterator(this, m_Data.size());
 	}
 
+	Iterator iteratorAt(size_t denseIndex)
+	{
+		assert(denseIndex <= m_Data.size());
+		return Iterator(this, denseIndex);
+	}
+
 	Iterator popIterator(const Iterator& it)
 	{
-		pop(it.m_Index);
+		pop(m_Dense[it.m_Index]);
 		return it;
 	}
 
 private:
-	static constexpr size_t k_Empty = std::numeric_limits<size_t>::max();
-	std::vector<size_t> m_Sparse;
-	std::vector<size_t> m_Dense;
-	std::vector<T> m_Data;
-};
\ No newline at end of file
+
+	// Pages that were never written all share this one, so lookups never branch on them
+	static constexpr std::array<Entity, k_PageSize> k_NullPage = []
+	{
+		std::array<Entity, k_PageSize> page;
+		page.fill(Handle::k_Null);
+		return page;
+	}();
+
+	// Dense index and generation of the item, packed like a handle, or k_Null
+	Entity sparseEntry(uint32_t index) const
+	{
+		return m_Pages[index >> k_PageShift][index & (k_PageSize - 1)];
+	}
+
+	Entity& sparseSlot(uint32_t index)
+	{
+		Entity*& page = m_Pages[index >> k_PageShift];
+
+		if (page == k_NullPage.data())
+		{
+			page = static_cast<Entity*>(sparsePagePool().allocate());
+			std::fill_n(page, k_PageSize, Handle::k_Null);
+		}
+
+		return page[index & (k_PageSize - 1)];
+	}
+
+	// Covers every possible index, a few kilobytes per set
+	std::array<Entity*, k_PageCount> m_Pages;
+	std::vector<Entity> m_Dense;
+	Storage m_Data;
+};
@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "SpatialGrid.hpp"
+
+// Keeps the average bucket well under one cell's worth of circles
+static constexpr uint32_t k_BucketsPerEntry = 2;
+static constexpr uint32_t k_MinBuckets = 64;
+
+void SpatialGrid::clear()
+{
+	m_Entries.clear();
+	m_MaxRadius = 0.0f;
+}
+
+void SpatialGrid::insert(Entity entity, Vec2 position, float radius)
+{
+	const Vec2i cell{ (int32_t)std::floor(position.x), (int32_t)std::floor(position.y) };
+
+	m_Entries.push_back({ entity, position, radius, cell });
+	m_MaxRadius = std::max(m_MaxRadius, radius);
+}
+
+void SpatialGrid::build()
+{
+	const uint32_t buckets = std::bit_ceil(std::max(k_MinBuckets, (uint32_t)m_Entries.size() * k_BucketsPerEntry));
+	m_BucketMask = buckets - 1;
+
+	// Two circles touch when their centers are within twice the largest radius
+	m_Reach = std::max(1, (int32_t)std::ceil(2.0f * m_MaxRadius));
+
+	// Counting sort, every bucket ends up as one contiguous range
+	m_BucketStart.assign(buckets + 1, 0);
+	for (const Entry& entry : m_Entries)
+	{
+		++m_BucketStart[bucketOf(entry.cell) + 1];
+	}
+
+	for (uint32_t bucket = 0; bucket < buckets; ++bucket)
+	{
+		m_BucketStart[bucket + 1] += m_BucketStart[bucket];
+	}
+
+	m_Scratch.resize(m_Entries.size());
+	m_Cursors.assign(m_BucketStart.begin(), m_BucketStart.end() - 1);
+
+	for (const Entry& entry : m_Entries)
+	{
+		m_Scratch[m_Cursors[bucketOf(entry.cell)]++] = entry;
+	}
+
+	m_Entries.swap(m_Scratch);
+}
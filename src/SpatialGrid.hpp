@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Core.hpp"
+#include "Entity.hpp"
+
+// Circles bucketed by the tile cell holding their center. Cells are hashed
+// into a power of two table, so the cost follows the circle count rather
+// than the size of the world.
+class SpatialGrid
+{
+public:
+
+	struct Entry
+	{
+		Entity entity;
+		Vec2 position;
+		float radius;
+		Vec2i cell;
+	};
+
+	void clear();
+	void insert(Entity entity, Vec2 position, float radius);
+	// Sorts the inserted circles by bucket, entries keep that order until the next clear
+	void build();
+
+	size_t size() const { return m_Entries.size(); }
+	const Entry& operator[](size_t index) const { return m_Entries[index]; }
+
+	// Calls function(index, entry) for every other circle whose cell is close
+	// enough to overlap the one at index. Only reads, so any number of threads
+	// can query a built grid at once.
+	template <typename F>
+	void forEachNear(size_t index, F&& function) const
+	{
+		const Entry& entry = m_Entries[index];
+
+		for (int32_t y = entry.cell.y - m_Reach; y <= entry.cell.y + m_Reach; ++y)
+		{
+			for (int32_t x = entry.cell.x - m_Reach; x <= entry.cell.x + m_Reach; ++x)
+			{
+				const uint32_t bucket = bucketOf({ x, y });
+
+				// Other cells can share the bucket, they are skipped by comparing the cell
+				for (uint32_t other = m_BucketStart[bucket]; other < m_BucketStart[bucket + 1]; ++other)
+				{
+					const Entry& candidate = m_Entries[other];
+					if (other == index || candidate.cell.x != x || candidate.cell.y != y) continue;
+
+					function((size_t)other, candidate);
+				}
+			}
+		}
+	}
+
+private:
+
+	uint32_t bucketOf(Vec2i cell) const
+	{
+		return ((uint32_t)cell.x * 73856093u ^ (uint32_t)cell.y * 19349663u) & m_BucketMask;
+	}
+
+	std::vector<Entry> m_Entries;
+	std::vector<Entry> m_Scratch;
+	// Entries of bucket b are [m_BucketStart[b], m_BucketStart[b + 1])
+	std::vector<uint32_t> m_BucketStart;
+	// Next free slot of every bucket while build scatters the entries
+	std::vector<uint32_t> m_Cursors;
+	uint32_t m_BucketMask = 0;
+	// Cells searched around a circle's own cell, enough for the largest radius
+	int32_t m_Reach = 1;
+	float m_MaxRadius = 0.0f;
+};
@@ -1,128 +1,437 @@
+#include <bit>
 #include "Systems.hpp"
 #include "EntityManager.hpp",
 #include "World.hpp"
 #include "Core.hpp"
+#include "Jobs.hpp"
+#include "Simd.hpp"
+#include "Profiler.hpp"
+#include "Memory.hpp"
 
-#include "raylib.h"
+static constexpr size_t k_EntityGrain = 256;
 
-static Vec2 calculateVelocity(Vec2 );
+// Keeps the largest push per axis over every solid tile the circle's bounding box touches
+static Vec2 resolveAgainstTiles(const World& level, Cir bounds)
+{
+	const int32_t worldWidth = level.width();
+	const int32_t worldHeight = level.height();
+
+	Vec2i starting{
+		bounds.pos.x - bounds.rad,
+		bounds.pos.y - bounds.rad
+	};
+
+	Vec2i ending{
+		bounds.pos.x + bounds.rad,
+		bounds.pos.y + bounds.rad
+	};
+
+	Vec2 fullResolution;
+
+	// Clamping once keeps the per cell test down to a single bitmap lookup
+	for (int32_t y = std::max(starting.y, 0); y <= std::min(ending.y, worldHeight - 1); ++y)
+	{
+		for (int32_t x = std::max(starting.x, 0); x <= std::min(ending.x, worldWidth - 1); ++x)
+		{
+			if (!level.isSolid({ x, y })) continue;
+
+			auto resolution = bounds.resolve(Rect(x, y, 1.0f, 1.0f));
+			fullResolution = Vec2(
+				std::abs(resolution.x) > std::abs(fullResolution.x) ?
+				resolution.x : fullResolution.x,
+				std::abs(resolution.y) > std::abs(fullResolution.y) ?
+				resolution.y : fullResolution.y
+			);
+		}
+	}
+
+	return fullResolution;
+}
 
 void Systems::resolveWorldColisions(GameContext& context)
 {
-	auto& transforms = context.entities.getSet<Comp::Transform>();
+	OPAL_PROFILE_SCOPE("Systems::resolveWorldColisions");
 
-	const int32_t worldWidth = context.level.width();
-	const int32_t worldHeight = context.level.height();
+	auto colliders = context.entities.view<Comp::Transform, Comp::Collider>();
 
-	for (const auto& [id, transform] : transforms)
+	Jobs::parallelFor(0, colliders.candidates(), k_EntityGrain, [&](size_t begin, size_t end)
 	{
-		if (!context.entities.has<Comp::Collider>(id)) continue;
+		colliders.each(begin, end, [&](Entity, auto&& transform, const Comp::Collider& collider)
+		{
+			Cir bounds(transform.position, collider.radius);
+
+			// The distance field answers for nearly everyone, the tiles only for the odd case it can't
+			auto resolution = context.level.resolveCircle(bounds);
+			if (!resolution) resolution = resolveAgainstTiles(context.level, bounds);
 
-		Cir bounds(
-			transform.position,
-			context.entities.get<Comp::Collider>(id).radius
-		);
+			transform.position += *resolution;
+		});
+	});
+}
 
-		Vec2i starting{
-			bounds.pos.x - bounds.rad,
-			bounds.pos.y - bounds.rad
-		};
+void Systems::resolveEntityColisions(GameContext& context)
+{
+	OPAL_PROFILE_SCOPE("Systems::resolveEntityColisions");
 
-		Vec2i ending{
-			bounds.pos.x + bounds.rad,
-			bounds.pos.y + bounds.rad
-		};
+	auto& grid = context.colliders;
 
-		Vec2 fullResolution;
+	grid.clear();
+	for (auto [id, transform, collider] : context.entities.view<Comp::Transform, Comp::Collider>())
+	{
+		grid.insert(id, transform.position, collider.radius);
+	}
+	grid.build();
 
-		for (int32_t y = starting.y; y <= ending.y; ++y)
+	// Every circle only sums the pushes it receives, read from the grid's copy
+	// of the positions, so jobs never write the same entity and the result
+	// does not depend on the thread count
+	Jobs::parallelFor(0, grid.size(), k_EntityGrain, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
 		{
-			if (y < 0 || y >= worldHeight) continue;
+			Cir bounds(grid[i].position, grid[i].radius);
+			Vec2 correction;
 
-			for (int32_t x = starting.x; x <= ending.x; ++x)
+			grid.forEachNear(i, [&](size_t other, const SpatialGrid::Entry& entry)
 			{
-				if (x < 0 || x >= worldWidth ||
-					!context.level.tile(y, x).isSolid())
+				Vec2 push = bounds.resolve(Cir(entry.position, entry.radius));
+
+				// Stacked centers get pushed the same way, the grid order splits them
+				if (entry.position.x == bounds.pos.x && entry.position.y == bounds.pos.y && other < i)
 				{
-					continue;
+					push = -push;
 				}
-				
-				auto resolution = bounds.resolve(Rect(x, y, 1.0f, 1.0f));
-				fullResolution = Vec2(
-					std::abs(resolution.x) > std::abs(fullResolution.x) ?
-					resolution.x : fullResolution.x,
-					std::abs(resolution.y) > std::abs(fullResolution.y) ?
-					resolution.y : fullResolution.y
-				);
-			}
+
+				correction += push * 0.5f;
+			});
+
+			if (correction.x == 0.0f && correction.y == 0.0f) continue;
+
+			context.entities.get<Comp::Transform>(grid[i].entity).position += correction;
+		}
+	});
+}
+
+using TransformColumn = SoaLayout<Comp::Transform>;
+using VelocityColumn = SoaLayout<Comp::Velocity>;
+
+static void integrateScalar(
+	const EntityManager::Array<Comp::Transform>& transforms,
+	const EntityManager::Array<Comp::Velocity>& velocities,
+	size_t begin, size_t end, float dt)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		transforms[i].position += velocities[i].current * dt;
+	}
+}
+
+static void accelerateScalar(const EntityManager::Array<Comp::Velocity>& velocities, size_t begin, size_t end, float dt)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		auto&& velocity = velocities[i];
+		Vec2 current = velocity.current;
+		const Vec2 direction = velocity.direction;
+
+		if (direction.x == 0.0f && direction.y == 0.0f)
+		{
+			float calculatedSpeed = current.length() - velocity.deceleration * dt;
+
+			velocity.current = calculatedSpeed <= 0.0f ? Vec2() : current.normalized() * calculatedSpeed;
+			continue;
 		}
 
-		transform.position += fullResolution;
+		current += direction * (velocity.acceleration * dt);
+
+		if (current.length() > velocity.max)
+		{
+			current = current.normalized() * velocity.max;
+		}
+
+		velocity.current = current;
+	}
+}
+
+#if defined(OPAL_SIMD_X86)
+
+OPAL_TARGET_AVX2
+static void integrateAvx2(
+	const EntityManager::Array<Comp::Transform>& transforms,
+	const EntityManager::Array<Comp::Velocity>& velocities,
+	size_t begin, size_t end, float dt)
+{
+	float* x = transforms.column(TransformColumn::PositionX);
+	float* y = transforms.column(TransformColumn::PositionY);
+	const float* velocityX = velocities.column(VelocityColumn::CurrentX);
+	const float* velocityY = velocities.column(VelocityColumn::CurrentY);
+
+	const __m256 step = _mm256_set1_ps(dt);
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		_mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_loadu_ps(velocityX + i), step)));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_loadu_ps(velocityY + i), step)));
 	}
+
+	// The scalar tail is SSE code, leaving the upper halves dirty would stall it
+	_mm256_zeroupper();
+	integrateScalar(transforms, velocities, i, end, dt);
 }
 
+// Same operations in the same order as accelerateScalar, both branches are
+// computed for all lanes and blended
+OPAL_TARGET_AVX2
+static void accelerateAvx2(const EntityManager::Array<Comp::Velocity>& velocities, size_t begin, size_t end, float dt)
+{
+	const float* max = velocities.column(VelocityColumn::Max);
+	const float* acceleration = velocities.column(VelocityColumn::Acceleration);
+	const float* deceleration = velocities.column(VelocityColumn::Deceleration);
+	float* currentX = velocities.column(VelocityColumn::CurrentX);
+	float* currentY = velocities.column(VelocityColumn::CurrentY);
+	const float* directionX = velocities.column(VelocityColumn::DirectionX);
+	const float* directionY = velocities.column(VelocityColumn::DirectionY);
+
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 step = _mm256_set1_ps(dt);
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		const __m256 x = _mm256_loadu_ps(currentX + i);
+		const __m256 y = _mm256_loadu_ps(currentY + i);
+		const __m256 dx = _mm256_loadu_ps(directionX + i);
+		const __m256 dy = _mm256_loadu_ps(directionY + i);
+
+		const __m256 idle = _mm256_and_ps(_mm256_cmp_ps(dx, zero, _CMP_EQ_OQ), _mm256_cmp_ps(dy, zero, _CMP_EQ_OQ));
+
+		// Slowing down, lanes whose speed would go negative stop
+		const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)));
+		const __m256 speed = _mm256_sub_ps(length, _mm256_mul_ps(_mm256_loadu_ps(deceleration + i), step));
+		const __m256 inverse = _mm256_div_ps(one, length);
+		const __m256 stopped = _mm256_cmp_ps(speed, zero, _CMP_LE_OQ);
+		const __m256 slowX = _mm256_andnot_ps(stopped, _mm256_mul_ps(_mm256_mul_ps(inverse, x), speed));
+		const __m256 slowY = _mm256_andnot_ps(stopped, _mm256_mul_ps(_mm256_mul_ps(inverse, y), speed));
+
+		// Speeding up, clamped to the maximum speed
+		const __m256 push = _mm256_mul_ps(_mm256_loadu_ps(acceleration + i), step);
+		const __m256 fastX = _mm256_add_ps(x, _mm256_mul_ps(dx, push));
+		const __m256 fastY = _mm256_add_ps(y, _mm256_mul_ps(dy, push));
+		const __m256 fastLength = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(fastX, fastX), _mm256_mul_ps(fastY, fastY)));
+		const __m256 limit = _mm256_loadu_ps(max + i);
+		const __m256 tooFast = _mm256_cmp_ps(fastLength, limit, _CMP_GT_OQ);
+		const __m256 fastInverse = _mm256_div_ps(one, fastLength);
+		const __m256 clampedX = _mm256_blendv_ps(fastX, _mm256_mul_ps(_mm256_mul_ps(fastInverse, fastX), limit), tooFast);
+		const __m256 clampedY = _mm256_blendv_ps(fastY, _mm256_mul_ps(_mm256_mul_ps(fastInverse, fastY), limit), tooFast);
+
+		_mm256_storeu_ps(currentX + i, _mm256_blendv_ps(clampedX, slowX, idle));
+		_mm256_storeu_ps(currentY + i, _mm256_blendv_ps(clampedY, slowY, idle));
+	}
+
+	// The scalar tail is SSE code, leaving the upper halves dirty would stall it
+	_mm256_zeroupper();
+	accelerateScalar(velocities, i, end, dt);
+}
+
+#endif
+
+// The kernels are cheap per entity, so jobs get bigger ranges than the other systems
+static constexpr size_t k_KernelGrain = 4096;
+
 void Systems::applyVelocity(GameContext& context, float dt)
 {
-	auto& velocities = context.entities.getSet<Comp::Velocity>();
+	OPAL_PROFILE_SCOPE("Systems::applyVelocity");
 
-	for (const auto& [id, velocity] : velocities)
+	auto moving = context.entities.group<Comp::Transform, Comp::Velocity>();
+	auto transforms = moving.data<Comp::Transform>();
+	auto velocities = moving.data<Comp::Velocity>();
+
+	Jobs::parallelFor(0, moving.size(), k_KernelGrain, [&](size_t begin, size_t end)
 	{
-		if (!context.entities.has<Comp::Transform>(id)) continue;
+#if defined(OPAL_SIMD_X86)
+		if (Simd::avx2Enabled())
+		{
+			integrateAvx2(transforms, velocities, begin, end, dt);
+			return;
+		}
+#endif
+		integrateScalar(transforms, velocities, begin, end, dt);
+	});
+}
+
+void Systems::moveAndSlide(GameContext& context, float dt)
+{
+	OPAL_PROFILE_SCOPE("Systems::moveAndSlide");
 
-		context.entities.get<Comp::Transform>(id).position += velocity.current * dt;
+	struct Start
+	{
+		Entity id;
+		Vec2 position;
+		float radius;
+	};
+
+	// The kernel moves the colliders like everything else, the sweep then walks that motion again
+	Memory::FrameVector<Start> starts;
+	for (auto [id, transform, velocity, collider] : context.entities.view<Comp::Transform, Comp::Velocity, Comp::Collider>())
+	{
+		starts.push_back({ id, transform.position, collider.radius });
 	}
+
+	applyVelocity(context, dt);
+
+	Jobs::parallelFor(0, starts.size(), k_EntityGrain, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const Start& start = starts[i];
+			auto&& transform = context.entities.get<Comp::Transform>(start.id);
+			const Vec2 motion = Vec2(transform.position) - start.position;
+
+			const auto slide = context.level.slideCircle(Cir(start.position, start.radius), motion);
+			transform.position = slide.position;
+			if (!slide.contacts) continue;
+
+			// Speed into a wall is lost, along it is kept
+			auto&& velocity = context.entities.get<Comp::Velocity>(start.id);
+			Vec2 current = velocity.current;
+			for (int32_t contact = 0; contact < slide.contacts; ++contact)
+			{
+				current -= slide.normals[contact] * std::min(current.dot(slide.normals[contact]), 0.0f);
+			}
+			velocity.current = current;
+		}
+	});
 }
 
-Vec2 calculateVelocity(float dt, Vec2 direction, GameContext& context, size_t id)
+void Systems::snapshotTransforms(GameContext& context)
 {
-	if (!context.entities.has<Comp::Velocity>(id)) return {};
+	OPAL_PROFILE_SCOPE("Systems::snapshotTransforms");
+
+	auto& transforms = context.entities.getSet<Comp::Transform>();
+	auto& previous = context.previousTransforms;
 
-	auto& velocity = context.entities.get<Comp::Velocity>(id);
+	// Clearing keeps the sparse pages, so after the first tick this is two linear copies
+	previous.clear();
+	previous.reserve(transforms.size());
 
-	if (direction.x == 0.0f && direction.y == 0.0f)
+	for (auto [id, transform] : transforms)
 	{
-		float calculatedSpeed = velocity.current.length() - velocity.deceleration * dt;
+		previous.insert(id, transform);
+	}
+}
+
+Comp::Transform Systems::interpolatedTransform(GameContext& context, Entity entity)
+{
+	Comp::Transform current = context.entities.get<Comp::Transform>(entity);
+	if (!context.previousTransforms.contains(entity)) return current;
 
-		if (calculatedSpeed <= 0.0f)
+	const Comp::Transform& previous = context.previousTransforms.at(entity);
+	const float blend = context.interpolation;
+
+	// Angles are never wrapped, so a plain lerp takes the short way
+	return Comp::Transform(
+		previous.position + (current.position - previous.position) * blend,
+		previous.angle + (current.angle - previous.angle) * blend
+	);
+}
+
+uint64_t Systems::hashTransforms(GameContext& context)
+{
+	// FNV-1a over the handle and the raw bits of every field, in dense order
+	uint64_t hash = 14695981039346656037ull;
+	const auto mix = [&hash](uint32_t bits)
+	{
+		for (int32_t byte = 0; byte < 4; ++byte)
 		{
-			velocity.current = {};
-			return velocity.current;
+			hash = (hash ^ ((bits >> (byte * 8)) & 0xFF)) * 1099511628211ull;
 		}
+	};
 
-		velocity.current = velocity.current.normalized() * calculatedSpeed;
-		return velocity.current;
+	for (auto [id, transform] : context.entities.getSet<Comp::Transform>())
+	{
+		mix(id);
+		mix(std::bit_cast<uint32_t>(transform.angle));
+		mix(std::bit_cast<uint32_t>(transform.position.x));
+		mix(std::bit_cast<uint32_t>(transform.position.y));
 	}
 
-	velocity.current += direction * (velocity.acceleration * dt);
+	return hash;
+}
 
-	if (velocity.current.length() > velocity.max)
+void Systems::accelerate(GameContext& context, float dt)
+{
+	OPAL_PROFILE_SCOPE("Systems::accelerate");
+
+	auto& set = context.entities.getSet<Comp::Velocity>();
+	auto velocities = set.data();
+
+	Jobs::parallelFor(0, set.size(), k_KernelGrain, [&](size_t begin, size_t end)
 	{
-		velocity.current = velocity.current.normalized() * velocity.max;
+#if defined(OPAL_SIMD_X86)
+		if (Simd::avx2Enabled())
+		{
+			accelerateAvx2(velocities, begin, end, dt);
+			return;
+		}
+#endif
+		accelerateScalar(velocities, begin, end, dt);
+	});
+}
+
+void Systems::streamWorld(GameContext& context, Entity cameraEntity)
+{
+	OPAL_PROFILE_SCOPE("Systems::streamWorld");
+	Memory::Tag tag(Memory::Subsystem::World);
+
+	Memory::FrameVector<World::StreamFocus> focus;
+	focus.push_back({ context.entities.get<Comp::Transform>(cameraEntity).position, World::k_ViewDistance });
+
+	for (auto [id, transform, collider] : context.entities.view<Comp::Transform, Comp::Collider>())
+	{
+		// One cell of margin covers everything resolveWorldColisions looks at
+		focus.push_back({ transform.position, collider.radius + 1.0f });
 	}
 
-	return velocity.current;
+	context.level.stream(focus);
 }
 
 static constexpr float k_MouseSpeed = 0.08f;
 
-void Systems::moveControlable(GameContext& context, float dt)
+void Systems::applyInput(GameContext& context, const Input::Frames& frames)
 {
+	OPAL_PROFILE_SCOPE("Systems::applyInput");
+
 	auto& controlables = context.entities.getSet<Comp::Controlable>();
 
-	for (const auto& [id, _] : controlables)
+	for (const auto& [entity, frame] : frames)
+	{
+		if (controlables.contains(entity)) controlables[entity].input = frame;
+	}
+}
+
+void Systems::moveControlable(GameContext& context, float dt)
+{
+	OPAL_PROFILE_SCOPE("Systems::moveControlable");
+
+	for (auto [id, controlable, transform] : context.entities.view<Comp::Controlable, Comp::Transform>())
 	{
-		auto& transform = context.entities.get<Comp::Transform>(id);
-		transform.angle += GetMouseDelta().x * k_MouseSpeed * dt;
+		const Input::Frame& input = controlable.input;
+		transform.angle += input.look * k_MouseSpeed * dt;
 		Vec2 direction;
 
-		if (IsKeyDown(KEY_W)) direction += Vec2::direction(transform.angle);
-		if (IsKeyDown(KEY_S)) direction += Vec2::direction(transform.angle + std::numbers::pi);
-		if (IsKeyDown(KEY_D)) direction += Vec2::direction(transform.angle + std::numbers::pi / 2.0f);
-		if (IsKeyDown(KEY_A)) direction += Vec2::direction(transform.angle - std::numbers::pi / 2.0f);
+		if (input.held(Input::Forward)) direction += Vec2::direction(transform.angle);
+		if (input.held(Input::Back)) direction += Vec2::direction(transform.angle + std::numbers::pi);
+		if (input.held(Input::Right)) direction += Vec2::direction(transform.angle + std::numbers::pi / 2.0f);
+		if (input.held(Input::Left)) direction += Vec2::direction(transform.angle - std::numbers::pi / 2.0f);
 
 		if (direction.dot(direction) > 1e-6f) direction.normalize();
 		else direction = {};
 
-		Vec2 deltaDistance = calculateVelocity(dt, direction, context, id) * dt;
+		if (context.entities.has<Comp::Velocity>(id))
+		{
+			context.entities.get<Comp::Velocity>(id).direction = direction;
+		}
 	}
 }
\ No newline at end of file
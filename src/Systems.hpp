@@ -2,17 +2,41 @@
 
 #include "World.hpp"
 #include "EntityManager.hpp"
+#include "SpatialGrid.hpp"
 
 struct GameContext
 {
 	World level;
 	EntityManager entities;
+	// Broadphase of resolveEntityColisions, kept around so its buffers are reused
+	SpatialGrid colliders;
+	// Transforms as they were before the last tick, rendering blends from them
+	// toward the current ones by interpolation, the fraction of a tick elapsed since
+	SparseSet<Comp::Transform> previousTransforms;
+	float interpolation = 1.0f;
 };
 
 namespace Systems
 {
 	void resolveWorldColisions(GameContext& context);
+	// Pushes overlapping colliders apart, each one takes half of every overlap
+	void resolveEntityColisions(GameContext& context);
 	void applyVelocity(GameContext& context, float dt);
-	void displayView(GameContext& context, size_t currentEntity);
+	// applyVelocity, except colliders sweep their motion against the walls and slide
+	// along them, so no step is long enough to pass through one
+	void moveAndSlide(GameContext& context, float dt);
+	// Speeds every velocity up along its direction, or slows it down when there is none
+	void accelerate(GameContext& context, float dt);
+	void displayView(GameContext& context, Entity currentEntity);
+	// Hands each frame to its entity, frames of entities that lost their Controlable are dropped
+	void applyInput(GameContext& context, const Input::Frames& frames);
 	void moveControlable(GameContext& context, float dt);
+	// Copies every Transform into previousTransforms, called right before a tick
+	void snapshotTransforms(GameContext& context);
+	// The transform blended between the last two ticks, entities spawned since only have the current one
+	Comp::Transform interpolatedTransform(GameContext& context, Entity entity);
+	// Hash of every Transform bit for bit, two runs agree only if they simulated the same thing
+	uint64_t hashTransforms(GameContext& context);
+	// Keeps the world resident around the camera and every entity with a collider
+	void streamWorld(GameContext& context, Entity cameraEntity);
 }
\ No newline at end of file
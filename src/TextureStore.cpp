@@ -0,0 +1,83 @@
+#include "TextureStore.hpp"
+
+static Col averageTexels(Col a, Col b, Col c, Col d)
+{
+	return Col(
+		(a.r + b.r + c.r + d.r + 2) / 4,
+		(a.g + b.g + c.g + d.g + 2) / 4,
+		(a.b + b.b + c.b + d.b + 2) / 4,
+		(a.a + b.a + c.a + d.a + 2) / 4
+	);
+}
+
+void TextureStore::add(TextureId id, const Col* pixels, int32_t width, int32_t height)
+{
+	if (id >= (TextureId)m_Textures.size()) m_Textures.resize(id + 1);
+
+	auto& texture = m_Textures[id];
+	texture.levels.clear();
+	texture.texels.clear();
+
+	texture.levels.push_back(Level{ width, height, 0 });
+	texture.texels.reserve(width * height * 4 / 3 + 1);
+
+	for (int32_t x = 0; x < width; ++x)
+	{
+		for (int32_t y = 0; y < height; ++y)
+		{
+			texture.texels.push_back(pixels[y * width + x]);
+		}
+	}
+
+	while (texture.levels.back().width > 1 || texture.levels.back().height > 1)
+	{
+		const Level previous = texture.levels.back();
+		const Level next{
+			std::max(previous.width / 2, 1),
+			std::max(previous.height / 2, 1),
+			texture.texels.size()
+		};
+
+		auto texel = [&](int32_t x, int32_t y)
+		{
+			x = std::min(x, previous.width - 1);
+			y = std::min(y, previous.height - 1);
+			return texture.texels[previous.offset + (size_t)x * previous.height + y];
+		};
+
+		for (int32_t x = 0; x < next.width; ++x)
+		{
+			for (int32_t y = 0; y < next.height; ++y)
+			{
+				texture.texels.push_back(averageTexels(
+					texel(x * 2, y * 2),
+					texel(x * 2 + 1, y * 2),
+					texel(x * 2, y * 2 + 1),
+					texel(x * 2 + 1, y * 2 + 1)
+				));
+			}
+		}
+
+		texture.levels.push_back(next);
+	}
+}
+
+void TextureStore::clear() { m_Textures.clear(); }
+
+bool TextureStore::contains(TextureId id) const
+{
+	return id >= 0 && id < (TextureId)m_Textures.size() && !m_Textures[id].levels.empty();
+}
+
+int32_t TextureStore::selectLevel(TextureId id, int32_t projectedHeight) const
+{
+	const auto& levels = m_Textures[id].levels;
+	int32_t selected = 0;
+
+	while (selected + 1 < (int32_t)levels.size() && levels[selected + 1].height >= projectedHeight)
+	{
+		++selected;
+	}
+
+	return selected;
+}
\ No newline at end of file
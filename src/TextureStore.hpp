@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Renderer.hpp"
+#include "Core.hpp"
+
+// CPU side copy of every texture, stored column-major so a wall slice is one
+// contiguous run of texels, with a box filtered mip chain per texture.
+class TextureStore
+{
+public:
+
+	struct Level
+	{
+		int32_t width;
+		int32_t height;
+		size_t offset;
+	};
+
+	void add(TextureId id, const Col* pixels, int32_t width, int32_t height);
+	void clear();
+	bool contains(TextureId id) const;
+
+	int32_t levelCount(TextureId id) const { return m_Textures[id].levels.size(); }
+	const Level& level(TextureId id, int32_t level) const { return m_Textures[id].levels[level]; }
+	// Smallest level that is still at least as tall as the wall it is drawn on
+	int32_t selectLevel(TextureId id, int32_t projectedHeight) const;
+
+	const Col* column(TextureId id, int32_t level, int32_t x) const
+	{
+		const auto& texture = m_Textures[id];
+		const auto& mip = texture.levels[level];
+		return texture.texels.data() + mip.offset + (size_t)x * mip.height;
+	}
+
+private:
+
+	struct Texture
+	{
+		std::vector<Level> levels;
+		std::vector<Col> texels;
+	};
+
+	std::vector<Texture> m_Textures;
+};
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <string>
 #include <cmath>
+#include <algorithm>
 #include <memory>
 #include "Renderer.hpp"
 #include "Components.hpp"
@@ -12,15 +13,35 @@ class Tile
 public:
 
 	Tile(const std::string& stringTextureId) :
-		m_TextureId(Renderer::getNumericalId(stringTextureId)) {}
+		m_TextureId(Renderer::getNumericalId(stringTextureId)),
+		m_FloorTextureId(Renderer::NO_TEXTURE),
+		m_CeilingTextureId(Renderer::NO_TEXTURE) {}
+
+	// Empty names leave that surface untextured, a tile without a wall is open space.
+	// light scales how bright its surfaces and the sprites standing on it are, 0 to 1.
+	Tile(const std::string& wall, const std::string& floor, const std::string& ceiling, float light = 1.0f) :
+		m_TextureId(Renderer::getNumericalId(wall)),
+		m_FloorTextureId(Renderer::getNumericalId(floor)),
+		m_CeilingTextureId(Renderer::getNumericalId(ceiling)),
+		m_Light((uint8_t)std::lround(std::clamp(light, 0.0f, 1.0f) * 255.0f)) {}
 
 	Tile() :
-		m_TextureId(Renderer::NO_TEXTURE) {}
+		m_TextureId(Renderer::NO_TEXTURE),
+		m_FloorTextureId(Renderer::NO_TEXTURE),
+		m_CeilingTextureId(Renderer::NO_TEXTURE) {}
 
 	TextureId textureId() const { return m_TextureId; }
+	TextureId floorTextureId() const { return m_FloorTextureId; }
+	TextureId ceilingTextureId() const { return m_CeilingTextureId; }
+	float light() const { return m_Light * (1.0f / 255.0f); }
 	bool isSolid() const { return m_TextureId != Renderer::NO_TEXTURE; }
 
+	bool operator==(const Tile&) const = default;
+
 private:
 
 	TextureId m_TextureId;
-};
\ No newline at end of file
+	TextureId m_FloorTextureId;
+	TextureId m_CeilingTextureId;
+	uint8_t m_Light = 255;
+};
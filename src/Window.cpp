@@ -3,14 +3,31 @@
 
 #include "RayCore.hpp"
 
-void Window::init(int32_t width, int32_t height, const char* name)
+static bool s_Headless = false;
+static int32_t s_HeadlessWidth = 0;
+static int32_t s_HeadlessHeight = 0;
+
+void Window::init(int32_t width, int32_t height, const char* name, bool vsync)
 {
-	SetConfigFlags(FLAG_VSYNC_HINT);
+	if (vsync) SetConfigFlags(FLAG_VSYNC_HINT);
 	InitWindow(width, height, name);
 	SetWindowState(FLAG_WINDOW_RESIZABLE);
 }
 
-void Window::close() { CloseWindow(); }
-bool Window::shouldClose() { return WindowShouldClose(); }
-int32_t Window::getWidth() { return GetScreenWidth(); }
-int32_t Window::getHeight() { return GetScreenHeight(); }
\ No newline at end of file
+void Window::initHeadless(int32_t width, int32_t height)
+{
+	s_Headless = true;
+	s_HeadlessWidth = width;
+	s_HeadlessHeight = height;
+}
+
+bool Window::isHeadless() { return s_Headless; }
+
+void Window::close()
+{
+	if (!s_Headless) CloseWindow();
+}
+
+bool Window::shouldClose() { return !s_Headless && WindowShouldClose(); }
+int32_t Window::getWidth() { return s_Headless ? s_HeadlessWidth : GetScreenWidth(); }
+int32_t Window::getHeight() { return s_Headless ? s_HeadlessHeight : GetScreenHeight(); }
\ No newline at end of file
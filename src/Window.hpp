@@ -5,7 +5,10 @@
 
 namespace Window
 {
-	void init(int32_t width, int32_t height, const char* name);
+	void init(int32_t width, int32_t height, const char* name, bool vsync = true);
+	// Renders without a display; sizes are fixed and no raylib window exists
+	void initHeadless(int32_t width, int32_t height);
+	bool isHeadless();
 	void close();
 	bool shouldClose();
 	int32_t getWidth();
@@ -1,55 +1,662 @@
+#include <bit>
+#include <cstring>
 #include "World.hpp"
+#include "Simd.hpp"
+#include "MapFormat.hpp"
+#include "Profiler.hpp"
+
+static_assert(World::k_ChunkSize == MapFormat::k_ChunkSize, "Binary maps store cells in world chunks");
+
+static float calculateSlicePoint(Vec2 origin, Vec2 direction, float distance, bool sideways, Vec2i step)
+{
+    auto finalHit = origin + direction * distance;
+    float point = 0.0f;
+    //fix slices not being calculated correctly
+    if (sideways)
+    {
+        if (step.x == 1) point = finalHit.y - floorf(finalHit.y);
+        else point = 1.0f - finalHit.y - floorf(finalHit.y);
+    }
+    else
+    {
+        if (step.y == 1) point = 1.0f - finalHit.x - floorf(finalHit.x);
+        else point = finalHit.x - floorf(finalHit.x);
+    }
+
+    return point;
+}
 
 World::World() :
     m_Width(0),
-    m_Height(0) {}
+    m_Height(0),
+    m_ChunksX(0),
+    m_ChunksY(0),
+    m_ChunkTableWidth(0),
+    m_SourceCells(nullptr),
+    m_StreamCounter(0) {}
 
 World::World(const nlohmann::json& mapping) :
-    m_Width(0),
-    m_Height(0)
+    World()
 {
     load(mapping);
 }
 
 void World::load(const nlohmann::json& mapping)
 {
-    size_t length = -1;
-    size_t size = 0;
-    for (const auto& line : mapping["map"])
+    const auto& rows = mapping["map"];
+
+    m_Width = rows.empty() ? 0 : rows[0].get_ref<const std::string&>().length();
+    m_Height = rows.size();
+    m_ChunksX = (m_Width + k_ChunkMask) >> k_ChunkShift;
+    m_ChunksY = (m_Height + k_ChunkMask) >> k_ChunkShift;
+    m_ChunkTableWidth = m_ChunksX + 2;
+
+    if (mapping.contains("spawnpoint"))
     {
-        if (length == -1)
+        m_Spawnpoint = Vec2(mapping["spawnpoint"][0].get<float>(), mapping["spawnpoint"][1].get<float>());
+    }
+
+    m_Lighting = Lighting();
+    m_Lighting.ambient = mapping.value("light", m_Lighting.ambient);
+
+    if (mapping.contains("fog"))
+    {
+        const auto& fog = mapping["fog"];
+        m_Lighting.fogStart = fog.value("start", m_Lighting.fogStart);
+        m_Lighting.fogEnd = fog.value("end", m_Lighting.fogEnd);
+
+        if (fog.contains("color"))
         {
-            length = line.get<std::string>().length();
+            m_Lighting.fogColor = Col(fog["color"][0].get<uint8_t>(), fog["color"][1].get<uint8_t>(), fog["color"][2].get<uint8_t>(), 255);
         }
+    }
 
-        if (length != line.get<std::string>().length())
+    // Palette index 0 is empty space, the rest follow the tile definitions
+    std::unordered_map<char, uint8_t> paletteIndices;
+    m_Palette.assign(1, Tile());
+    for (const auto& [ch, tile] : m_Tiles)
+    {
+        paletteIndices[ch] = m_Palette.size();
+        m_Palette.push_back(tile);
+    }
+
+    m_MappedFile.close();
+    m_OwnedCells.assign((size_t)m_ChunksX * m_ChunksY * k_ChunkCells, 0);
+
+    for (int32_t y = 0; y < m_Height; ++y)
+    {
+        const auto& line = rows[y].get_ref<const std::string&>();
+
+        if (line.length() != m_Width)
         {
             std::cerr << "The amount of columns is not equal in each row.";
         }
 
-        ++size;
+        for (int32_t x = 0; x < std::min<int32_t>(line.length(), m_Width); ++x)
+        {
+            auto paletteIndex = paletteIndices.find(line[x]);
+            if (paletteIndex == paletteIndices.end()) continue;
+
+            const size_t chunk = (size_t)(y >> k_ChunkShift) * m_ChunksX + (x >> k_ChunkShift);
+            m_OwnedCells[(chunk << (2 * k_ChunkShift)) | ((y & k_ChunkMask) << k_ChunkShift) | (x & k_ChunkMask)] =
+                paletteIndex->second;
+        }
+    }
+
+    m_SourceCells = m_OwnedCells.data();
+    resetChunks();
+}
+
+bool World::loadBinary(const std::string& path)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        std::cerr << "Could not map " << path << std::endl;
+        return false;
+    }
+
+    if (file.size() < sizeof(MapFormat::Header))
+    {
+        std::cerr << path << " is too small to be a map" << std::endl;
+        return false;
+    }
+
+    MapFormat::Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, MapFormat::k_Magic, sizeof(header.magic)) != 0 ||
+        header.version != MapFormat::k_Version ||
+        header.chunkSize != k_ChunkSize)
+    {
+        std::cerr << path << " is not a version " << MapFormat::k_Version << " map" << std::endl;
+        return false;
+    }
+
+    const size_t chunks = MapFormat::chunkCount(header.width, k_ChunkSize) * MapFormat::chunkCount(header.height, k_ChunkSize);
+    const bool fits =
+        header.width >= 0 && header.height >= 0 &&
+        file.contains(header.paletteOffset, (uint64_t)header.paletteCount * sizeof(MapFormat::PaletteEntry)) &&
+        header.cellsSize == chunks * k_ChunkCells &&
+        file.contains(header.cellsOffset, header.cellsSize);
+
+    if (!fits)
+    {
+        std::cerr << path << " is truncated or corrupted" << std::endl;
+        return false;
+    }
+
+    m_Palette.assign(1, Tile());
+    for (uint32_t i = 1; i < header.paletteCount; ++i)
+    {
+        MapFormat::PaletteEntry entry;
+        std::memcpy(&entry, file.data() + header.paletteOffset + i * sizeof(entry), sizeof(entry));
+        auto name = [](const char* text) { return std::string(text, strnlen(text, MapFormat::k_NameLength)); };
+        m_Palette.emplace_back(name(entry.textureName), name(entry.floorName), name(entry.ceilingName), entry.light);
+    }
+
+    m_Width = header.width;
+    m_Height = header.height;
+    m_ChunksX = MapFormat::chunkCount(m_Width, k_ChunkSize);
+    m_ChunksY = MapFormat::chunkCount(m_Height, k_ChunkSize);
+    m_ChunkTableWidth = m_ChunksX + 2;
+    m_Spawnpoint = Vec2(header.spawnX, header.spawnY);
+    m_Lighting.ambient = header.ambientLight;
+    m_Lighting.fogStart = header.fogStart;
+    m_Lighting.fogEnd = header.fogEnd;
+    m_Lighting.fogColor = Col(header.fogColor[0], header.fogColor[1], header.fogColor[2], 255);
+
+    m_OwnedCells.clear();
+    m_MappedFile = std::move(file);
+    m_SourceCells = m_MappedFile.data() + header.cellsOffset;
+    resetChunks();
+
+    return true;
+}
+
+void World::resetChunks()
+{
+    // The sentinel and unloaded slots come first and never move
+    m_TilePool.assign(2 * k_ChunkCells, Tile());
+    m_SolidPool.assign(2 * k_ChunkSize, 0);
+    std::fill_n(m_SolidPool.begin(), k_ChunkSize, ~uint64_t(0));
+    // Zero clearance sends queries to the bitmap, which is right for both
+    m_FieldPool.assign(2 * k_ChunkCells, 0);
+    m_FreeSlots.clear();
+    m_EditedChunks.clear();
+
+    m_ChunkSlots.assign((size_t)m_ChunkTableWidth * (m_ChunksY + 2), k_SentinelSlot);
+    m_LastNeeded.assign(m_ChunkSlots.size(), 0);
+    m_ResidentChunks.clear();
+    m_StreamCounter = 0;
+
+    for (int32_t chunkY = 0; chunkY < m_ChunksY; ++chunkY)
+    {
+        for (int32_t chunkX = 0; chunkX < m_ChunksX; ++chunkX)
+        {
+            m_ChunkSlots[chunkEntry(chunkX, chunkY)] = k_UnloadedSlot;
+        }
+    }
+
+    if ((size_t)m_ChunksX * m_ChunksY * k_ChunkBytes > m_Streaming.memoryBudget) return;
+
+    for (int32_t chunkY = 0; chunkY < m_ChunksY; ++chunkY)
+    {
+        for (int32_t chunkX = 0; chunkX < m_ChunksX; ++chunkX)
+        {
+            makeResident(chunkX, chunkY);
+        }
+    }
+}
+
+int32_t World::allocateSlot()
+{
+    if (!m_FreeSlots.empty())
+    {
+        int32_t slot = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+        return slot;
+    }
+
+    const int32_t slot = m_SolidPool.size() / k_ChunkSize;
+    // The SIMD raycaster gathers bitmap words with 32 bit indices
+    assert(((size_t)slot + 1) * k_ChunkCells < ((size_t)1 << 31));
+
+    m_TilePool.resize(m_TilePool.size() + k_ChunkCells);
+    m_SolidPool.resize(m_SolidPool.size() + k_ChunkSize);
+    m_FieldPool.resize(m_FieldPool.size() + k_ChunkCells);
+    return slot;
+}
+
+void World::makeResident(int32_t chunkX, int32_t chunkY)
+{
+    const int32_t entry = chunkEntry(chunkX, chunkY);
+    if (m_ChunkSlots[entry] != k_UnloadedSlot) return;
+
+    const int32_t slot = allocateSlot();
+    const size_t chunk = (size_t)chunkY * m_ChunksX + chunkX;
+    const auto edited = m_EditedChunks.find(chunk);
+    const uint8_t* source = edited != m_EditedChunks.end() ? edited->second.data() : &m_SourceCells[chunk * k_ChunkCells];
+    Tile* tiles = &m_TilePool[(size_t)slot * k_ChunkCells];
+    uint64_t* solid = &m_SolidPool[(size_t)slot * k_ChunkSize];
+
+    // Cells of an edge chunk that fall outside the map become sentinels
+    const int32_t columns = std::min(k_ChunkSize, m_Width - (chunkX << k_ChunkShift));
+    const int32_t rows = std::min(k_ChunkSize, m_Height - (chunkY << k_ChunkShift));
+
+    for (int32_t y = 0; y < k_ChunkSize; ++y)
+    {
+        uint64_t row = 0;
+
+        for (int32_t x = 0; x < k_ChunkSize; ++x)
+        {
+            const int32_t cell = (y << k_ChunkShift) | x;
+            const bool inside = x < columns && y < rows;
+
+            // Palette indices come straight from disk for binary maps, so they are not trusted
+            tiles[cell] = inside && source[cell] < m_Palette.size() ? m_Palette[source[cell]] : Tile();
+            if (!inside || tiles[cell].isSolid()) row |= uint64_t(1) << x;
+        }
+
+        solid[y] = row;
+    }
+
+    m_ChunkSlots[entry] = slot;
+    m_ResidentChunks.push_back(entry);
+
+    // Neighbours saw this chunk as empty, the cells within reach of it can only get closer to a wall.
+    // Evicting needs no such pass, the stale values can only be too low.
+    const int32_t firstX = chunkX << k_ChunkShift;
+    const int32_t firstY = chunkY << k_ChunkShift;
+    refreshField(firstX - k_FieldReach, firstY - k_FieldReach, firstX + k_ChunkMask + k_FieldReach, firstY + k_ChunkMask + k_FieldReach);
+}
+
+void World::setTile(Vec2i pos, const Tile& tile)
+{
+    assert(contains(pos));
+
+    auto paletteEntry = std::find(m_Palette.begin(), m_Palette.end(), tile);
+
+    if (paletteEntry == m_Palette.end())
+    {
+        assert(m_Palette.size() < 256);
+        paletteEntry = m_Palette.insert(m_Palette.end(), tile);
     }
 
-    m_Width = length;
-    m_Height = size;
+    // Edits go to a copy of the chunk, binary maps are mapped read only
+    const size_t chunk = (size_t)(pos.y >> k_ChunkShift) * m_ChunksX + (pos.x >> k_ChunkShift);
+    auto [edited, created] = m_EditedChunks.try_emplace(chunk);
+    if (created)
+    {
+        const uint8_t* source = &m_SourceCells[chunk * k_ChunkCells];
+        edited->second.assign(source, source + k_ChunkCells);
+    }
+
+    edited->second[((pos.y & k_ChunkMask) << k_ChunkShift) | (pos.x & k_ChunkMask)] = paletteEntry - m_Palette.begin();
+
+    if (m_ChunkSlots[chunkEntry(pos.x >> k_ChunkShift, pos.y >> k_ChunkShift)] == k_UnloadedSlot) return;
 
-    for (const auto& line : mapping["map"])
+    const size_t cell = cellIndex(pos.x, pos.y);
+    const uint64_t bit = uint64_t(1) << (cell & 63);
+
+    m_TilePool[cell] = tile;
+    if (tile.isSolid()) m_SolidPool[cell >> 6] |= bit;
+    else m_SolidPool[cell >> 6] &= ~bit;
+
+    refreshField(pos.x - k_FieldReach, pos.y - k_FieldReach, pos.x + k_FieldReach, pos.y + k_FieldReach);
+}
+
+uint64_t World::solidRow(int32_t x, int32_t y) const
+{
+    const int32_t shift = x & k_ChunkMask;
+    const uint64_t first = m_SolidPool[cellIndex(x, y) >> 6];
+    if (shift == 0) return first;
+
+    const uint64_t second = m_SolidPool[cellIndex(x + k_ChunkSize - shift, y) >> 6];
+    return first >> shift | second << (k_ChunkSize - shift);
+}
+
+uint8_t World::computeClearance(int32_t x, int32_t y) const
+{
+    constexpr uint64_t k_Window = (uint64_t(1) << (2 * k_FieldReach + 1)) - 1;
+    constexpr uint64_t k_LeftHalf = (uint64_t(1) << (k_FieldReach + 1)) - 1;
+
+    // Squared gap between the cell and the closest solid cell of each row, in whole cells
+    int32_t closest = k_FieldReach * k_FieldReach;
+
+    for (int32_t dy = -k_FieldReach; dy <= k_FieldReach; ++dy)
     {
-        for (const auto& ch : line.get<std::string>())
+        const uint64_t row = solidRow(x - k_FieldReach, y + dy) & k_Window;
+        if (!row) continue;
+
+        // Bit k_FieldReach is the cell's own column
+        const uint64_t left = row & k_LeftHalf;
+        const uint64_t right = row >> k_FieldReach;
+        int32_t dx = k_FieldReach;
+        if (left) dx = k_FieldReach - (63 - std::countl_zero(left));
+        if (right) dx = std::min(dx, std::countr_zero(right));
+
+        const int32_t gapX = std::max(dx - 1, 0);
+        const int32_t gapY = std::max(std::abs(dy) - 1, 0);
+        closest = std::min(closest, gapX * gapX + gapY * gapY);
+    }
+
+    return (uint8_t)(std::sqrt((float)closest) * k_FieldScale);
+}
+
+void World::refreshField(int32_t firstX, int32_t firstY, int32_t lastX, int32_t lastY)
+{
+    firstX = std::max(firstX, 0);
+    firstY = std::max(firstY, 0);
+    lastX = std::min(lastX, m_Width - 1);
+    lastY = std::min(lastY, m_Height - 1);
+
+    for (int32_t y = firstY; y <= lastY; ++y)
+    {
+        for (int32_t x = firstX; x <= lastX; ++x)
+        {
+            const int32_t slot = m_ChunkSlots[chunkEntry(x >> k_ChunkShift, y >> k_ChunkShift)];
+            if (slot == k_UnloadedSlot) continue;
+
+            m_FieldPool[cellIndex(x, y)] = computeClearance(x, y);
+        }
+    }
+}
+
+std::optional<World::Contact> World::nearestSolid(Vec2 position, float reach) const
+{
+    const int32_t column = (int32_t)floorf(position.x);
+    const int32_t firstX = (int32_t)floorf(position.x - reach);
+    const int32_t lastX = (int32_t)floorf(position.x + reach);
+    const int32_t firstY = (int32_t)floorf(position.y - reach);
+    const int32_t lastY = (int32_t)floorf(position.y + reach);
+
+    const uint64_t window = (uint64_t(2) << (lastX - firstX)) - 1;
+    const uint64_t leftHalf = (uint64_t(2) << (column - firstX)) - 1;
+
+    std::optional<Contact> nearest;
+
+    for (int32_t y = firstY; y <= lastY; ++y)
+    {
+        const uint64_t row = solidRow(firstX, y) & window;
+        if (!row) continue;
+
+        // Within a row the closest cells are the first solid one on each side of the position
+        const uint64_t left = row & leftHalf;
+        const uint64_t right = row >> (column - firstX);
+        int32_t candidates[2];
+        int32_t count = 0;
+        if (left) candidates[count++] = firstX + 63 - std::countl_zero(left);
+        if (right) candidates[count++] = column + std::countr_zero(right);
+
+        for (int32_t i = 0; i < count; ++i)
         {
-            if (ch == ' ')
+            const float x = (float)candidates[i];
+            const Vec2 point(std::clamp(position.x, x, x + 1.0f), std::clamp(position.y, (float)y, y + 1.0f));
+            const float distance = (position - point).length();
+
+            if (!nearest || distance < nearest->distance) nearest = Contact{ point, distance };
+        }
+    }
+
+    return nearest;
+}
+
+std::optional<Vec2> World::resolveCircle(const Cir& bounds) const
+{
+    static constexpr int32_t k_Iterations = 4;
+
+    const auto cellOf = [](Vec2 position) { return Vec2i{ (int32_t)floorf(position.x), (int32_t)floorf(position.y) }; };
+
+    if (bounds.rad >= k_FieldReach || !contains(cellOf(bounds.pos))) return std::nullopt;
+    if (clearance(cellOf(bounds.pos)) >= bounds.rad) return Vec2();
+
+    // Each step leaves the closest wall along the gradient, a few of them settle corners
+    Vec2 position = bounds.pos;
+    for (int32_t i = 0; i < k_Iterations; ++i)
+    {
+        const Vec2i cell = cellOf(position);
+        if (!contains(cell) || isSolid(cell)) return std::nullopt;
+
+        const auto contact = nearestSolid(position, bounds.rad);
+        if (!contact || contact->distance >= bounds.rad) break;
+        // Touching a wall exactly gives no direction to leave it in
+        if (contact->distance == 0.0f) return std::nullopt;
+
+        position += (position - contact->point) / contact->distance * (bounds.rad - contact->distance);
+    }
+
+    return position - bounds.pos;
+}
+
+void World::evict(int32_t entry)
+{
+    m_FreeSlots.push_back(m_ChunkSlots[entry]);
+    m_ChunkSlots[entry] = k_UnloadedSlot;
+}
+
+void World::stream(std::span<const StreamFocus> focus)
+{
+    const uint32_t stamp = ++m_StreamCounter;
+
+    for (const auto& point : focus)
+    {
+        const int32_t firstX = std::max(0, (int32_t)floorf(point.position.x - point.radius) >> k_ChunkShift);
+        const int32_t firstY = std::max(0, (int32_t)floorf(point.position.y - point.radius) >> k_ChunkShift);
+        const int32_t lastX = std::min(m_ChunksX - 1, (int32_t)floorf(point.position.x + point.radius) >> k_ChunkShift);
+        const int32_t lastY = std::min(m_ChunksY - 1, (int32_t)floorf(point.position.y + point.radius) >> k_ChunkShift);
+
+        for (int32_t chunkY = firstY; chunkY <= lastY; ++chunkY)
+        {
+            for (int32_t chunkX = firstX; chunkX <= lastX; ++chunkX)
             {
-                m_Map.emplace_back();
+                const int32_t entry = chunkEntry(chunkX, chunkY);
+                if (m_LastNeeded[entry] == stamp) continue;
+
+                m_LastNeeded[entry] = stamp;
+                makeResident(chunkX, chunkY);
             }
-            else if (m_Tiles.count(ch))
+        }
+    }
+
+    const size_t budgetChunks = m_Streaming.memoryBudget / k_ChunkBytes;
+    if (m_ResidentChunks.size() <= budgetChunks) return;
+
+    // Oldest first, chunks needed by this call are never evicted even over budget
+    std::sort(m_ResidentChunks.begin(), m_ResidentChunks.end(), [this](int32_t a, int32_t b)
+    {
+        return m_LastNeeded[a] < m_LastNeeded[b];
+    });
+
+    size_t evicted = 0;
+    while (m_ResidentChunks.size() - evicted > budgetChunks &&
+        m_LastNeeded[m_ResidentChunks[evicted]] != stamp)
+    {
+        evict(m_ResidentChunks[evicted++]);
+    }
+
+    m_ResidentChunks.erase(m_ResidentChunks.begin(), m_ResidentChunks.begin() + evicted);
+}
+
+std::optional<World::SweepHit> World::sweepCircle(const Cir& bounds, Vec2 motion) const
+{
+    const Vec2i startCell{ (int32_t)floorf(bounds.pos.x), (int32_t)floorf(bounds.pos.y) };
+    if (bounds.rad >= k_FieldReach || !contains(startCell) || isSolid(startCell)) return std::nullopt;
+    if (motion.x == 0.0f && motion.y == 0.0f) return std::nullopt;
+
+    // Any cell the circle can touch is within this many cells of the one under its center
+    const int32_t reach = (int32_t)std::ceil(bounds.rad);
+    const uint64_t window = (uint64_t(2) << (2 * reach)) - 1;
+
+    // Motion fractions at which the center crosses the next cell line on each axis
+    const Vec2i step{ motion.x < 0.0f ? -1 : 1, motion.y < 0.0f ? -1 : 1 };
+    const Vec2 delta(
+        motion.x != 0.0f ? 1.0f / std::abs(motion.x) : INFINITY,
+        motion.y != 0.0f ? 1.0f / std::abs(motion.y) : INFINITY
+    );
+    Vec2 next(
+        (step.x > 0 ? startCell.x + 1.0f - bounds.pos.x : bounds.pos.x - startCell.x) * delta.x,
+        (step.y > 0 ? startCell.y + 1.0f - bounds.pos.y : bounds.pos.y - startCell.y) * delta.y
+    );
+
+    std::optional<SweepHit> nearest;
+    Vec2i cell = startCell;
+    float entered = 0.0f;
+
+    // A contact happens while the center is in some cell, so once the walk enters
+    // cells after the nearest contact found so far nothing can beat it
+    while (entered <= 1.0f && (!nearest || entered <= nearest->time) && contains(cell))
+    {
+        if (clearance(cell) <= bounds.rad)
+        {
+            for (int32_t y = cell.y - reach; y <= cell.y + reach; ++y)
             {
-                m_Map.push_back(m_Tiles[ch]);
+                for (uint64_t row = solidRow(cell.x - reach, y) & window; row; row &= row - 1)
+                {
+                    const Vec2i solid{ cell.x - reach + std::countr_zero(row), y };
+                    const auto hit = sweepCell(bounds.pos, motion, bounds.rad, solid);
+                    if (hit && (!nearest || hit->time < nearest->time)) nearest = hit;
+                }
             }
         }
+
+        if (next.x < next.y)
+        {
+            entered = next.x;
+            next.x += delta.x;
+            cell.x += step.x;
+        }
+        else
+        {
+            entered = next.y;
+            next.y += delta.y;
+            cell.y += step.y;
+        }
     }
+
+    return nearest;
+}
+
+std::optional<World::SweepHit> World::sweepCell(Vec2 start, Vec2 motion, float radius, Vec2i cell) const
+{
+    const float minX = (float)cell.x;
+    const float minY = (float)cell.y;
+    const float maxX = minX + 1.0f;
+    const float maxY = minY + 1.0f;
+
+    // Sides shared with another solid cell are inside the wall, touching them would snag sliding circles
+    const bool openLeft = !isSolid({ cell.x - 1, cell.y });
+    const bool openRight = !isSolid({ cell.x + 1, cell.y });
+    const bool openTop = !isSolid({ cell.x, cell.y - 1 });
+    const bool openBottom = !isSolid({ cell.x, cell.y + 1 });
+
+    const Vec2 closest(std::clamp(start.x, minX, maxX), std::clamp(start.y, minY, maxY));
+    const Vec2 offset = start - closest;
+    const float distanceSquared = offset.dot(offset);
+
+    if (distanceSquared < radius * radius)
+    {
+        // Already touching, only motion going deeper is stopped so the circle can always get out
+        const bool openCorner =
+            (closest.x == start.x || (closest.x == minX ? openLeft : openRight)) &&
+            (closest.y == start.y || (closest.y == minY ? openTop : openBottom));
+
+        if (!openCorner || distanceSquared == 0.0f || motion.dot(offset) >= 0.0f) return std::nullopt;
+        return SweepHit{ 0.0f, offset / sqrtf(distanceSquared) };
+    }
+
+    std::optional<SweepHit> hit;
+    const auto consider = [&hit](float time, Vec2 normal)
+    {
+        if (time >= 0.0f && time <= 1.0f && (!hit || time < hit->time)) hit = SweepHit{ time, normal };
+    };
+
+    // Sides pushed out by the radius
+    const auto side = [&](float plane, float startAxis, float motionAxis, float startOther, float motionOther, float low, float high) -> std::optional<float>
+    {
+        const float time = (plane - startAxis) / motionAxis;
+        const float other = startOther + motionOther * time;
+        if (other < low || other > high) return std::nullopt;
+        return time;
+    };
+
+    if (openLeft && motion.x > 0.0f)
+    {
+        if (auto time = side(minX - radius, start.x, motion.x, start.y, motion.y, minY, maxY)) consider(*time, Vec2(-1.0f, 0.0f));
+    }
+    if (openRight && motion.x < 0.0f)
+    {
+        if (auto time = side(maxX + radius, start.x, motion.x, start.y, motion.y, minY, maxY)) consider(*time, Vec2(1.0f, 0.0f));
+    }
+    if (openTop && motion.y > 0.0f)
+    {
+        if (auto time = side(minY - radius, start.y, motion.y, start.x, motion.x, minX, maxX)) consider(*time, Vec2(0.0f, -1.0f));
+    }
+    if (openBottom && motion.y < 0.0f)
+    {
+        if (auto time = side(maxY + radius, start.y, motion.y, start.x, motion.x, minX, maxX)) consider(*time, Vec2(0.0f, 1.0f));
+    }
+
+    // Corners are circles of the radius, only where both sides next to them are open
+    const auto corner = [&](Vec2 point)
+    {
+        const Vec2 relative = start - point;
+        const float a = motion.dot(motion);
+        const float b = relative.dot(motion);
+        const float c = relative.dot(relative) - radius * radius;
+        const float discriminant = b * b - a * c;
+        if (b >= 0.0f || discriminant < 0.0f) return;
+
+        const float time = (-b - sqrtf(discriminant)) / a;
+        consider(time, (relative + motion * time) / radius);
+    };
+
+    if (openLeft && openTop) corner(Vec2(minX, minY));
+    if (openRight && openTop) corner(Vec2(maxX, minY));
+    if (openLeft && openBottom) corner(Vec2(minX, maxY));
+    if (openRight && openBottom) corner(Vec2(maxX, maxY));
+
+    return hit;
+}
+
+World::SlideResult World::slideCircle(const Cir& bounds, Vec2 motion) const
+{
+    // Contacts stop this far from the wall, so the next sweep does not start out touching it
+    static constexpr float k_Skin = 1e-3f;
+
+    SlideResult result;
+    result.position = bounds.pos;
+
+    for (int32_t i = 0; i < k_MaxSlides; ++i)
+    {
+        const auto hit = sweepCircle(Cir(result.position, bounds.rad), motion);
+        if (!hit)
+        {
+            result.position += motion;
+            return result;
+        }
+
+        result.position += motion * hit->time + hit->normal * k_Skin;
+        result.normals[result.contacts++] = hit->normal;
+
+        // The rest of the motion without the part going into the wall
+        motion *= 1.0f - hit->time;
+        motion -= hit->normal * std::min(motion.dot(hit->normal), 0.0f);
+    }
+
+    // Still blocked after every slide, most likely wedged in a corner
+    return result;
 }
 
 std::optional<World::RaycastResult> World::raycast(Vec2 origin, Vec2 direction) const
+{
+    // The sentinel border only stops rays that start inside the map
+    if (contains(static_cast<Vec2i>(origin))) return walkRay<false>(origin, direction);
+    return walkRay<true>(origin, direction);
+}
+
+template <bool Bounded>
+std::optional<World::RaycastResult> World::walkRay(Vec2 origin, Vec2 direction) const
 {
     Vec2 rayUnitStepSize = {
         sqrtf(1 + (direction.y / direction.x) * (direction.y / direction.x)),
@@ -82,8 +689,7 @@ std::optional<World::RaycastResult> World::raycast(Vec2 origin, Vec2 direction)
 
     std::optional<RaycastResult> out;
     float distance = 0.0f;
-    float const maxDistance = 100.0f;
-    while (distance < maxDistance)
+    while (distance < k_ViewDistance)
     {
         bool sideways = false;
         if (rayLength1D.x < rayLength1D.y)
@@ -100,43 +706,272 @@ std::optional<World::RaycastResult> World::raycast(Vec2 origin, Vec2 direction)
             rayLength1D.y += rayUnitStepSize.y;
         }
 
-        if (mapCheck.x >= 0 && mapCheck.y >= 0 &&
-            mapCheck.x < m_Width && mapCheck.y < m_Height &&
-            tile(mapCheck).isSolid())
+        if constexpr (Bounded)
         {
-            auto finalHit = origin + direction * distance;
-            float point = 0.0f;
-            //fix slices not being calculated correctly
-            if (sideways)
-            {
-                if (step.x == 1) point = finalHit.y - floorf(finalHit.y);
-                else point = 1.0f - finalHit.y - floorf(finalHit.y);
-            }
-            else
-            {
-                if (step.y == 1) point = 1.0f - finalHit.x - floorf(finalHit.x);
-                else point = finalHit.x - floorf(finalHit.x);
-            }
+            if (!contains(mapCheck)) continue;
+        }
 
+        const size_t cell = cellIndex(mapCheck.x, mapCheck.y);
+        if (!testSolid(cell)) continue;
+
+        // A solid cell without a texture is the sentinel, the ray left the map
+        const Tile& hit = m_TilePool[cell];
+        if (hit.isSolid())
+        {
             out = RaycastResult{
                 sideways,
-                tile(mapCheck).textureId(),
+                hit.textureId(),
                 distance,
-                point
+                calculateSlicePoint(origin, direction, distance, sideways, step),
+                hit.light()
             };
-
-            break;
         }
+
+        break;
     }
     
     return out;
 }
 
+void World::RaycastColumns::resize(size_t count)
+{
+    distance.resize(count);
+    point.resize(count);
+    textureId.resize(count);
+    sideways.resize(count);
+    hit.resize(count);
+    light.resize(count);
+}
+
+void World::ColumnRays::build(size_t count, float fieldOfView)
+{
+    if (count == size() && fieldOfView == this->fieldOfView) return;
+
+    this->fieldOfView = fieldOfView;
+    cosine.resize(count);
+    sine.resize(count);
+    tangent.resize(count);
+
+    const float increment = fieldOfView / (float)count;
+    for (size_t column = 0; column < count; ++column)
+    {
+        const float offset = column * increment - fieldOfView * 0.5f;
+        cosine[column] = cosf(offset);
+        sine[column] = sinf(offset);
+        tangent[column] = sine[column] / cosine[column];
+    }
+}
+
+// The table direction rotated by the view direction, both cast paths use exactly these operations
+static Vec2 columnDirection(Vec2 view, const World::ColumnRays& rays, size_t column)
+{
+    return Vec2(
+        view.x * rays.cosine[column] - view.y * rays.sine[column],
+        view.y * rays.cosine[column] + view.x * rays.sine[column]
+    );
+}
+
+void World::raycastColumns(Vec2 origin, float angle, const ColumnRays& rays, RaycastColumns& out) const
+{
+    out.resize(rays.size());
+    raycastColumns(origin, angle, rays, 0, rays.size(), out);
+}
+
+void World::raycastColumns(Vec2 origin, float angle, const ColumnRays& rays, size_t first, size_t count, RaycastColumns& out) const
+{
+    OPAL_PROFILE_SCOPE("World::raycastColumns");
+
+    assert(first + count <= out.size() && first + count <= rays.size());
+
+    const Vec2 view = Vec2::direction(angle);
+
+#if defined(OPAL_SIMD_X86)
+    if (Simd::avx2Enabled() && contains(static_cast<Vec2i>(origin)))
+    {
+        raycastColumnsAvx2(origin, view, rays, first, count, out);
+        return;
+    }
+#endif
+
+    raycastColumnsScalar(origin, view, rays, first, count, out);
+}
+
+void World::raycastColumnsScalar(Vec2 origin, Vec2 view, const ColumnRays& rays, size_t first, size_t count, RaycastColumns& out) const
+{
+    for (size_t column = first; column < first + count; ++column)
+    {
+        auto hit = raycast(origin, columnDirection(view, rays, column));
+
+        out.hit[column] = hit.has_value();
+        out.distance[column] = hit ? hit->distance : 0.0f;
+        out.point[column] = hit ? hit->point : 0.0f;
+        out.textureId[column] = hit ? hit->textureId : Renderer::NO_TEXTURE;
+        out.sideways[column] = hit ? hit->sideways : false;
+        out.light[column] = hit ? hit->light : 1.0f;
+    }
+}
+
+#if defined(OPAL_SIMD_X86)
+// Same DDA as World::raycast, eight rays at a time. Every lane performs the exact
+// float operations of the scalar walk, so both paths produce identical results.
+// Occupancy comes from gathering bitmap words, the origin must be inside the map.
+OPAL_TARGET_AVX2
+void World::raycastColumnsAvx2(Vec2 origin, Vec2 view, const ColumnRays& rays, size_t first, size_t count, RaycastColumns& out) const
+{
+    constexpr size_t k_Lanes = 8;
+
+    const Vec2i originCell = static_cast<Vec2i>(origin);
+    const __m256 originX = _mm256_set1_ps(origin.x);
+    const __m256 originY = _mm256_set1_ps(origin.y);
+    const __m256 viewX = _mm256_set1_ps(view.x);
+    const __m256 viewY = _mm256_set1_ps(view.y);
+    const __m256 originCellX = _mm256_set1_ps((float)originCell.x);
+    const __m256 originCellY = _mm256_set1_ps((float)originCell.y);
+    const __m256 nextCellX = _mm256_set1_ps((float)(originCell.x + 1));
+    const __m256 nextCellY = _mm256_set1_ps((float)(originCell.y + 1));
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 maxDistance = _mm256_set1_ps(k_ViewDistance);
+    const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i chunkTableWidth = _mm256_set1_epi32(m_ChunkTableWidth);
+    const __m256i chunkMask = _mm256_set1_epi32(k_ChunkMask);
+    const __m256i wordBits = _mm256_set1_epi32(31);
+    const __m256i lowBit = _mm256_set1_epi32(1);
+    const int* chunkSlots = m_ChunkSlots.data();
+    const int* solidWords = reinterpret_cast<const int*>(m_SolidPool.data());
+
+    const size_t end = first + count;
+    for (; first + k_Lanes <= end; first += k_Lanes)
+    {
+        // Separate multiplies and adds, the same roundings as columnDirection
+        const __m256 cosine = _mm256_loadu_ps(rays.cosine.data() + first);
+        const __m256 sine = _mm256_loadu_ps(rays.sine.data() + first);
+        const __m256 dirX = _mm256_sub_ps(_mm256_mul_ps(viewX, cosine), _mm256_mul_ps(viewY, sine));
+        const __m256 dirY = _mm256_add_ps(_mm256_mul_ps(viewY, cosine), _mm256_mul_ps(viewX, sine));
+        alignas(32) float directionX[k_Lanes];
+        alignas(32) float directionY[k_Lanes];
+        _mm256_store_ps(directionX, dirX);
+        _mm256_store_ps(directionY, dirY);
+        const __m256 ratioYX = _mm256_div_ps(dirY, dirX);
+        const __m256 ratioXY = _mm256_div_ps(dirX, dirY);
+        const __m256 unitStepX = _mm256_sqrt_ps(_mm256_add_ps(one, _mm256_mul_ps(ratioYX, ratioYX)));
+        const __m256 unitStepY = _mm256_sqrt_ps(_mm256_add_ps(one, _mm256_mul_ps(ratioXY, ratioXY)));
+
+        const __m256 negativeX = _mm256_cmp_ps(dirX, zero, _CMP_LT_OQ);
+        const __m256 negativeY = _mm256_cmp_ps(dirY, zero, _CMP_LT_OQ);
+        const __m256i stepX = _mm256_blendv_epi8(_mm256_set1_epi32(1), _mm256_set1_epi32(-1), _mm256_castps_si256(negativeX));
+        const __m256i stepY = _mm256_blendv_epi8(_mm256_set1_epi32(1), _mm256_set1_epi32(-1), _mm256_castps_si256(negativeY));
+
+        __m256 rayLengthX = _mm256_mul_ps(
+            _mm256_blendv_ps(_mm256_sub_ps(nextCellX, originX), _mm256_sub_ps(originX, originCellX), negativeX),
+            unitStepX);
+        __m256 rayLengthY = _mm256_mul_ps(
+            _mm256_blendv_ps(_mm256_sub_ps(nextCellY, originY), _mm256_sub_ps(originY, originCellY), negativeY),
+            unitStepY);
+        __m256i mapX = _mm256_set1_epi32(originCell.x);
+        __m256i mapY = _mm256_set1_epi32(originCell.y);
+        __m256 distance = zero;
+
+        for (size_t lane = 0; lane < k_Lanes; ++lane)
+        {
+            out.hit[first + lane] = false;
+            out.distance[first + lane] = 0.0f;
+            out.point[first + lane] = 0.0f;
+            out.textureId[first + lane] = Renderer::NO_TEXTURE;
+            out.sideways[first + lane] = false;
+            out.light[first + lane] = 1.0f;
+        }
+
+        int activeLanes = 0xFF;
+        while (true)
+        {
+            activeLanes &= _mm256_movemask_ps(_mm256_cmp_ps(distance, maxDistance, _CMP_LT_OQ));
+            if (!activeLanes) break;
+
+            const __m256 active = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+                _mm256_and_si256(_mm256_set1_epi32(activeLanes), laneBits), laneBits));
+            const __m256 alongX = _mm256_cmp_ps(rayLengthX, rayLengthY, _CMP_LT_OQ);
+            const __m256 moveX = _mm256_and_ps(active, alongX);
+            const __m256 moveY = _mm256_andnot_ps(alongX, active);
+
+            mapX = _mm256_add_epi32(mapX, _mm256_and_si256(stepX, _mm256_castps_si256(moveX)));
+            mapY = _mm256_add_epi32(mapY, _mm256_and_si256(stepY, _mm256_castps_si256(moveY)));
+            distance = _mm256_blendv_ps(distance, rayLengthX, moveX);
+            distance = _mm256_blendv_ps(distance, rayLengthY, moveY);
+            rayLengthX = _mm256_blendv_ps(rayLengthX, _mm256_add_ps(rayLengthX, unitStepX), moveX);
+            rayLengthY = _mm256_blendv_ps(rayLengthY, _mm256_add_ps(rayLengthY, unitStepY), moveY);
+
+            // Same lookup as cellIndex, the sentinel ring makes chunk coordinates -1 valid
+            const __m256i chunkX = _mm256_srai_epi32(mapX, k_ChunkShift);
+            const __m256i chunkY = _mm256_srai_epi32(mapY, k_ChunkShift);
+            const __m256i entry = _mm256_add_epi32(
+                _mm256_mullo_epi32(_mm256_add_epi32(chunkY, lowBit), chunkTableWidth),
+                _mm256_add_epi32(chunkX, lowBit));
+            const __m256i slot = _mm256_i32gather_epi32(chunkSlots, entry, 4);
+            const __m256i cell = _mm256_or_si256(
+                _mm256_slli_epi32(slot, 2 * k_ChunkShift),
+                _mm256_or_si256(
+                    _mm256_slli_epi32(_mm256_and_si256(mapY, chunkMask), k_ChunkShift),
+                    _mm256_and_si256(mapX, chunkMask)));
+
+            // Lanes that already stopped never move, so every index stays inside the padded grid
+            const __m256i words = _mm256_i32gather_epi32(solidWords, _mm256_srli_epi32(cell, 5), 4);
+            const __m256i solid = _mm256_and_si256(
+                _mm256_srlv_epi32(words, _mm256_and_si256(cell, wordBits)), lowBit);
+            const int stoppedLanes = activeLanes &
+                _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(solid, lowBit)));
+            if (!stoppedLanes) continue;
+
+            alignas(32) int32_t cellIndices[k_Lanes];
+            alignas(32) float laneDistance[k_Lanes];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(cellIndices), cell);
+            _mm256_store_ps(laneDistance, distance);
+            const int sidewaysLanes = _mm256_movemask_ps(moveX);
+
+            for (int lanes = stoppedLanes; lanes; lanes &= lanes - 1)
+            {
+                const int lane = std::countr_zero(static_cast<uint32_t>(lanes));
+                activeLanes &= ~(1 << lane);
+
+                // A solid cell without a texture is the sentinel, the ray left the map
+                const Tile& hit = m_TilePool[cellIndices[lane]];
+                if (!hit.isSolid()) continue;
+
+                const size_t column = first + lane;
+                out.hit[column] = true;
+                out.distance[column] = laneDistance[lane];
+                out.textureId[column] = hit.textureId();
+                out.light[column] = hit.light();
+                out.sideways[column] = (sidewaysLanes >> lane) & 1;
+            }
+        }
+
+        // Slice points use plain SSE code, leaving the wide registers dirty while it
+        // runs stalls every instruction on some Intel cores
+        _mm256_zeroupper();
+
+        for (size_t lane = 0; lane < k_Lanes; ++lane)
+        {
+            const size_t column = first + lane;
+            if (!out.hit[column]) continue;
+
+            const Vec2 direction(directionX[lane], directionY[lane]);
+            const Vec2i step{ direction.x < 0 ? -1 : 1, direction.y < 0 ? -1 : 1 };
+            out.point[column] = calculateSlicePoint(origin, direction, out.distance[column], out.sideways[column], step);
+        }
+    }
+
+    raycastColumnsScalar(origin, view, rays, first, end - first, out);
+}
+#endif
+
 void World::loadTiles(const nlohmann::json& mapping)
 {
     for (const auto& [key, value] : mapping.items())
     {
-        m_Tiles[key[0]] = Tile(value.get<std::string>());
+        // A plain name is a wall, objects may give any of a wall, floor and ceiling texture
+        if (value.is_string()) m_Tiles[key[0]] = Tile(value.get<std::string>());
+        else m_Tiles[key[0]] = Tile(value.value("wall", ""), value.value("floor", ""), value.value("ceiling", ""), value.value("light", 1.0f));
     }
 }
 
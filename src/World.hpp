@@ -1,20 +1,59 @@
 #pragma once
 
 #include <optional>
+#include <array>
+#include <vector>
+#include <span>
 #include <unordered_map>
 #include <string>
+#include <cstdint>
+#include <limits>
 #include "nlohmann/json.hpp"
 #include "Renderer.hpp"
 #include "Core.hpp"
 #include "Tile.hpp"
+#include "MappedFile.hpp"
 
 class World
 {
 public:
 
+	static constexpr int32_t k_ChunkShift = 6;
+	static constexpr int32_t k_ChunkSize = 1 << k_ChunkShift;
+	static constexpr int32_t k_ChunkCells = k_ChunkSize * k_ChunkSize;
+	static constexpr float k_ViewDistance = 100.0f;
+	// Furthest distance to a solid cell the clearance field tells apart,
+	// colliders at least this big always take the slow path
+	static constexpr int32_t k_FieldReach = 8;
+
+	struct StreamingSettings
+	{
+		size_t memoryBudget = 64 << 20;
+	};
+
+	// Per map settings of the renderer's colormap
+	struct Lighting
+	{
+		// Scales the light of every tile
+		float ambient = 1.0f;
+		// Surfaces fade into the fog color between these distances, no fog by default
+		float fogStart = std::numeric_limits<float>::infinity();
+		float fogEnd = std::numeric_limits<float>::infinity();
+		Col fogColor = Colors::Black;
+	};
+
+	// Keeps every cell within radius of the position resident
+	struct StreamFocus
+	{
+		Vec2 position;
+		float radius;
+	};
+
 	World();
 	World(const nlohmann::json& mapping);
 	void load(const nlohmann::json& mapping);
+	// Maps a .opalmap written by opal_mapc, its cells are used straight from the file
+	bool loadBinary(const std::string& path);
 
 	struct RaycastResult
 	{
@@ -22,22 +61,179 @@ public:
 		TextureId textureId = Renderer::NO_TEXTURE;
 		float distance = 0.0f;
 		float point = 0.0f;
+		float light = 1.0f;
+	};
+
+	struct RaycastColumns
+	{
+		std::vector<float> distance;
+		std::vector<float> point;
+		std::vector<TextureId> textureId;
+		std::vector<uint8_t> sideways;
+		std::vector<uint8_t> hit;
+		std::vector<float> light;
+
+		void resize(size_t count);
+		size_t size() const { return hit.size(); }
+	};
+
+	// Directions of the view columns relative to the view direction, spread evenly
+	// over the field of view. The cosine is also the fisheye correction of the column.
+	struct ColumnRays
+	{
+		std::vector<float> cosine;
+		std::vector<float> sine;
+		// Sine over cosine, how far across the view a column's ray lands per unit of depth
+		std::vector<float> tangent;
+		float fieldOfView = 0.0f;
+
+		// Only recomputes the table when the column count or the field of view changed
+		void build(size_t count, float fieldOfView);
+		size_t size() const { return cosine.size(); }
 	};
 
 	std::optional<RaycastResult> raycast(Vec2 origin, Vec2 direction) const;
+	// Casts every ray of the table, rotated to look along angle
+	void raycastColumns(Vec2 origin, float angle, const ColumnRays& rays, RaycastColumns& out) const;
+	// Fills columns [first, first + count) of an already sized result, so ranges can be cast in parallel
+	void raycastColumns(Vec2 origin, float angle, const ColumnRays& rays, size_t first, size_t count, RaycastColumns& out) const;
 	int32_t width() const { return m_Width; }
 	int32_t height() const { return m_Height; }
-	const Tile& tile(float y, float x) const { return m_Map.at(y * m_Width + x); }
-	const Tile& tile(Vec2i pos) const { return m_Map.at(pos.y * m_Width + pos.x); }
+	Vec2 spawnpoint() const { return m_Spawnpoint; }
+	const Lighting& lighting() const { return m_Lighting; }
+	const Tile& tile(float y, float x) const { return tile(Vec2i{ (int32_t)x, (int32_t)y }); }
+	const Tile& tile(Vec2i pos) const
+	{
+		assert(contains(pos));
+		return m_TilePool[cellIndex(pos.x, pos.y)];
+	}
+	bool contains(Vec2i pos) const { return pos.x >= 0 && pos.y >= 0 && pos.x < m_Width && pos.y < m_Height; }
+	// Reads the solidity bitmap, the sentinel cells up to a chunk outside the map count as solid
+	bool isSolid(Vec2i pos) const { return testSolid(cellIndex(pos.x, pos.y)); }
+	// Replaces a cell, keeping the edit when its chunk gets evicted and reloaded
+	void setTile(Vec2i pos, const Tile& tile);
+
+	// Lower bound of the distance from any point of the cell to a solid cell,
+	// capped at k_FieldReach. Cells of chunks that are not resident read 0.
+	float clearance(Vec2i pos) const { return m_FieldPool[cellIndex(pos.x, pos.y)] * (1.0f / k_FieldScale); }
+	// Pushes a circle out of the walls along the distance field gradient, one
+	// lookup when it is clear of them. Empty when the circle is too big, outside
+	// the map or its center is inside a wall, the caller has to fall back to
+	// resolving against every tile then.
+	std::optional<Vec2> resolveCircle(const Cir& bounds) const;
+
+	struct SweepHit
+	{
+		// Fraction of the motion covered before touching
+		float time;
+		Vec2 normal;
+	};
+
+	static constexpr int32_t k_MaxSlides = 3;
+
+	struct SlideResult
+	{
+		Vec2 position;
+		// Walls met on the way, in order
+		std::array<Vec2, k_MaxSlides> normals;
+		int32_t contacts = 0;
+	};
+
+	// Earliest contact of a circle moving by motion with a solid cell, walking the
+	// cells under its center like raycast. Empty for circles resolveCircle can't handle.
+	std::optional<SweepHit> sweepCircle(const Cir& bounds, Vec2 motion) const;
+	// Moves a circle by motion, sliding along the walls it meets instead of passing through
+	SlideResult slideCircle(const Cir& bounds, Vec2 motion) const;
+
+	void setStreamingSettings(const StreamingSettings& settings) { m_Streaming = settings; }
+	// Makes the chunks around every focus resident and evicts the least recently
+	// needed ones once the memory budget is exceeded. Chunks that are not resident
+	// read as empty space. Small maps that fit the budget stay resident from load.
+	void stream(std::span<const StreamFocus> focus);
+	size_t residentChunks() const { return m_ResidentChunks.size(); }
+	size_t residentBytes() const { return m_ResidentChunks.size() * k_ChunkBytes; }
 
 	static void loadTiles(const nlohmann::json& mapping);
 	static void unloadTiles();
 
 private:
 
-	std::vector<Tile> m_Map;
+	static constexpr int32_t k_ChunkMask = k_ChunkSize - 1;
+	static constexpr size_t k_ChunkBytes = k_ChunkCells * sizeof(Tile) + k_ChunkCells / 8 + k_ChunkCells;
+	// Clearance is stored in sixteenths of a cell, k_FieldReach at most
+	static constexpr int32_t k_FieldScale = 16;
+	static_assert(k_FieldReach * k_FieldScale <= 255 && 2 * k_FieldReach + 1 < 64);
+	// Every chunk outside the map shares the solid sentinel slot, missing chunks share the empty one
+	static constexpr int32_t k_SentinelSlot = 0;
+	static constexpr int32_t k_UnloadedSlot = 1;
+
+	// The chunk table has a ring of sentinel chunks around the map, so any cell
+	// within a chunk of the map resolves without bounds checks
+	int32_t chunkEntry(int32_t chunkX, int32_t chunkY) const { return (chunkY + 1) * m_ChunkTableWidth + chunkX + 1; }
+
+	// Index into the tile and bitmap pools, a chunk row is exactly one bitmap word
+	size_t cellIndex(int32_t x, int32_t y) const
+	{
+		const size_t slot = m_ChunkSlots[chunkEntry(x >> k_ChunkShift, y >> k_ChunkShift)];
+		return (slot << (2 * k_ChunkShift)) | ((y & k_ChunkMask) << k_ChunkShift) | (x & k_ChunkMask);
+	}
+
+	bool testSolid(size_t cell) const { return (m_SolidPool[cell >> 6] >> (cell & 63)) & 1; }
+	// Solidity of the 64 cells starting at x, bit i is cell x + i
+	uint64_t solidRow(int32_t x, int32_t y) const;
+
+	struct Contact
+	{
+		Vec2 point;
+		float distance;
+	};
+
+	// Closest point of the solid cells within reach of a position outside of them
+	std::optional<Contact> nearestSolid(Vec2 position, float reach) const;
+	std::optional<SweepHit> sweepCell(Vec2 start, Vec2 motion, float radius, Vec2i cell) const;
+	uint8_t computeClearance(int32_t x, int32_t y) const;
+	// Recomputes the clearance of the resident cells in the inclusive range
+	void refreshField(int32_t firstX, int32_t firstY, int32_t lastX, int32_t lastY);
+
+	void resetChunks();
+	void makeResident(int32_t chunkX, int32_t chunkY);
+	void evict(int32_t entry);
+	int32_t allocateSlot();
+
+	template <bool Bounded>
+	std::optional<RaycastResult> walkRay(Vec2 origin, Vec2 direction) const;
+	void raycastColumnsScalar(Vec2 origin, Vec2 view, const ColumnRays& rays, size_t first, size_t count, RaycastColumns& out) const;
+	void raycastColumnsAvx2(Vec2 origin, Vec2 view, const ColumnRays& rays, size_t first, size_t count, RaycastColumns& out) const;
+
 	int32_t m_Width;
 	int32_t m_Height;
+	int32_t m_ChunksX;
+	int32_t m_ChunksY;
+	int32_t m_ChunkTableWidth;
+	Vec2 m_Spawnpoint;
+	Lighting m_Lighting;
+
+	// Source cells are palette indices stored chunk by chunk, decoded into a slot on demand.
+	// They point into the mapped file for binary maps and into m_OwnedCells for json ones.
+	std::vector<Tile> m_Palette;
+	const uint8_t* m_SourceCells;
+	std::vector<uint8_t> m_OwnedCells;
+	MappedFile m_MappedFile;
+	// Copies of the source chunks changed by setTile, by chunk index
+	std::unordered_map<size_t, std::vector<uint8_t>> m_EditedChunks;
+
+	// Chunk table entry to pool slot, plus the decoded slots themselves
+	std::vector<int32_t> m_ChunkSlots;
+	std::vector<Tile> m_TilePool;
+	std::vector<uint64_t> m_SolidPool;
+	std::vector<uint8_t> m_FieldPool;
+	std::vector<int32_t> m_FreeSlots;
+
+	// Table entries of resident chunks and the stream call that last needed each one
+	std::vector<int32_t> m_ResidentChunks;
+	std::vector<uint32_t> m_LastNeeded;
+	uint32_t m_StreamCounter;
+	StreamingSettings m_Streaming;
 
 	static inline std::unordered_map<char, Tile> m_Tiles;
 };
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 int32_t main(int32_t argc, char** argv)
 {
-	Game::init();
+	Game::init(Game::parseArguments(argc, argv));
 	Game::loop();
 	Game::cleanup();
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "MapFormat.hpp"
+
+// Compiles a json map and the tile definitions into a .opalmap
+// usage: opal_mapc <map.json> <tiles.json> <output.opalmap>
+
+static bool readJson(const char* path, nlohmann::json& out)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Could not open " << path << std::endl;
+		return false;
+	}
+
+	try
+	{
+		file >> out;
+	}
+	catch (const nlohmann::json::exception& exception)
+	{
+		std::cerr << path << ": " << exception.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+int32_t main(int32_t argc, char** argv)
+{
+	if (argc != 4)
+	{
+		std::cerr << "usage: opal_mapc <map.json> <tiles.json> <output.opalmap>" << std::endl;
+		return 1;
+	}
+
+	nlohmann::json mapping, tiles;
+	if (!readJson(argv[1], mapping) || !readJson(argv[2], tiles)) return 1;
+
+	std::vector<MapFormat::PaletteEntry> palette(1, MapFormat::PaletteEntry{});
+	palette[0].light = 1.0f;
+	std::unordered_map<char, uint8_t> paletteIndices;
+
+	for (const auto& [key, value] : tiles.items())
+	{
+		// A plain name is a wall, objects may give any of a wall, floor and ceiling texture
+		const bool wallOnly = value.is_string();
+		const std::string names[] = {
+			wallOnly ? value.get<std::string>() : value.value("wall", ""),
+			wallOnly ? "" : value.value("floor", ""),
+			wallOnly ? "" : value.value("ceiling", "")
+		};
+
+		const bool namesFit = std::all_of(std::begin(names), std::end(names), [](const std::string& name)
+		{
+			return name.length() < MapFormat::k_NameLength;
+		});
+
+		if (!namesFit || palette.size() > UINT8_MAX)
+		{
+			std::cerr << "Tile " << key << " does not fit the palette" << std::endl;
+			return 1;
+		}
+
+		MapFormat::PaletteEntry entry{};
+		std::memcpy(entry.textureName, names[0].data(), names[0].length());
+		std::memcpy(entry.floorName, names[1].data(), names[1].length());
+		std::memcpy(entry.ceilingName, names[2].data(), names[2].length());
+		entry.light = wallOnly ? 1.0f : value.value("light", 1.0f);
+
+		paletteIndices[key[0]] = palette.size();
+		palette.push_back(entry);
+	}
+
+	const auto& rows = mapping["map"];
+	const int32_t width = rows.empty() ? 0 : rows[0].get_ref<const std::string&>().length();
+	const int32_t height = rows.size();
+	constexpr int32_t k_ChunkSize = MapFormat::k_ChunkSize;
+	const size_t chunksX = MapFormat::chunkCount(width, k_ChunkSize);
+	const size_t chunksY = MapFormat::chunkCount(height, k_ChunkSize);
+
+	std::vector<uint8_t> cells(chunksX * chunksY * k_ChunkSize * k_ChunkSize, 0);
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		const auto& line = rows[y].get_ref<const std::string&>();
+		if ((int32_t)line.length() != width)
+		{
+			std::cerr << "Row " << y << " has " << line.length() << " columns instead of " << width << std::endl;
+		}
+
+		for (int32_t x = 0; x < std::min<int32_t>(line.length(), width); ++x)
+		{
+			// Spaces stay empty unless the tiles give open space a floor or ceiling
+			auto paletteIndex = paletteIndices.find(line[x]);
+			if (paletteIndex == paletteIndices.end())
+			{
+				if (line[x] == ' ') continue;
+
+				std::cerr << "Unknown tile '" << line[x] << "' at " << x << ", " << y << std::endl;
+				continue;
+			}
+
+			const size_t chunk = (y / k_ChunkSize) * chunksX + x / k_ChunkSize;
+			cells[chunk * k_ChunkSize * k_ChunkSize + (y % k_ChunkSize) * k_ChunkSize + x % k_ChunkSize] =
+				paletteIndex->second;
+		}
+	}
+
+	MapFormat::Header header{};
+	std::memcpy(header.magic, MapFormat::k_Magic, sizeof(header.magic));
+	header.version = MapFormat::k_Version;
+	header.width = width;
+	header.height = height;
+	header.chunkSize = k_ChunkSize;
+	header.spawnX = mapping.contains("spawnpoint") ? mapping["spawnpoint"][0].get<float>() : 0.0f;
+	header.spawnY = mapping.contains("spawnpoint") ? mapping["spawnpoint"][1].get<float>() : 0.0f;
+	header.paletteCount = palette.size();
+	header.paletteOffset = sizeof(header);
+	const size_t paletteEnd = header.paletteOffset + palette.size() * sizeof(MapFormat::PaletteEntry);
+	header.cellsOffset = (paletteEnd + MapFormat::k_CellsAlignment - 1) / MapFormat::k_CellsAlignment * MapFormat::k_CellsAlignment;
+	header.cellsSize = cells.size();
+
+	// Same defaults as World::Lighting
+	const auto fog = mapping.value("fog", nlohmann::json::object());
+	header.ambientLight = mapping.value("light", 1.0f);
+	header.fogStart = fog.value("start", std::numeric_limits<float>::infinity());
+	header.fogEnd = fog.value("end", std::numeric_limits<float>::infinity());
+	for (size_t channel = 0; channel < 3; ++channel)
+	{
+		header.fogColor[channel] = fog.contains("color") ? fog["color"][channel].get<uint8_t>() : 0;
+	}
+	header.fogColor[3] = 255;
+
+	std::ofstream output(argv[3], std::ios::binary);
+	if (!output)
+	{
+		std::cerr << "Could not create " << argv[3] << std::endl;
+		return 1;
+	}
+
+	const std::vector<char> padding(header.cellsOffset - paletteEnd, 0);
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(palette.data()), palette.size() * sizeof(MapFormat::PaletteEntry));
+	output.write(padding.data(), padding.size());
+	output.write(reinterpret_cast<const char*>(cells.data()), cells.size());
+
+	if (!output)
+	{
+		std::cerr << "Could not write " << argv[3] << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "AssetPackFormat.hpp"
+
+#include "raylib.h"
+
+// Decodes every texture listed in a textures json into a .opalpack
+// usage: opal_packc <textures.json> <output.opalpack> [--mipmaps]
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+int32_t main(int32_t argc, char** argv)
+{
+	if (argc < 3 || argc > 4 || (argc == 4 && std::string_view(argv[3]) != "--mipmaps"))
+	{
+		std::cerr << "usage: opal_packc <textures.json> <output.opalpack> [--mipmaps]" << std::endl;
+		return 1;
+	}
+
+	const bool mipmaps = argc == 4;
+	SetTraceLogLevel(LOG_WARNING);
+
+	nlohmann::json mapping;
+	{
+		std::ifstream file(argv[1]);
+		if (!file)
+		{
+			std::cerr << "Could not open " << argv[1] << std::endl;
+			return 1;
+		}
+		file >> mapping;
+	}
+
+	std::vector<AssetPackFormat::Entry> entries;
+	std::vector<Image> images;
+
+	for (const auto& [key, path] : mapping.items())
+	{
+		if (key.length() >= AssetPackFormat::k_NameLength)
+		{
+			std::cerr << "Texture name " << key << " is too long" << std::endl;
+			return 1;
+		}
+
+		Image image = LoadImage(path.get<std::string>().c_str());
+		if (!image.data)
+		{
+			std::cerr << "Could not decode " << path.get<std::string>() << std::endl;
+			return 1;
+		}
+
+		ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+		if (mipmaps) ImageMipmaps(&image);
+
+		AssetPackFormat::Entry entry{};
+		std::memcpy(entry.name, key.data(), key.length());
+		entry.width = image.width;
+		entry.height = image.height;
+		entry.mipmaps = image.mipmaps;
+		entry.pixelsSize = AssetPackFormat::pixelsSize(image.width, image.height, image.mipmaps);
+
+		entries.push_back(entry);
+		images.push_back(image);
+	}
+
+	AssetPackFormat::Header header{};
+	std::memcpy(header.magic, AssetPackFormat::k_Magic, sizeof(header.magic));
+	header.version = AssetPackFormat::k_Version;
+	header.entryCount = entries.size();
+	header.indexOffset = sizeof(header);
+
+	uint64_t offset = header.indexOffset + entries.size() * sizeof(AssetPackFormat::Entry);
+	for (auto& entry : entries)
+	{
+		offset = alignUp(offset, AssetPackFormat::k_PixelsAlignment);
+		entry.pixelsOffset = offset;
+		offset += entry.pixelsSize;
+	}
+
+	std::ofstream output(argv[2], std::ios::binary);
+	if (!output)
+	{
+		std::cerr << "Could not create " << argv[2] << std::endl;
+		return 1;
+	}
+
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	output.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPackFormat::Entry));
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const std::vector<char> padding(entries[i].pixelsOffset - (uint64_t)output.tellp(), 0);
+		output.write(padding.data(), padding.size());
+		output.write(static_cast<const char*>(images[i].data), entries[i].pixelsSize);
+		UnloadImage(images[i]);
+	}
+
+	if (!output)
+	{
+		std::cerr << "Could not write " << argv[2] << std::endl;
+		return 1;
+	}
+
+	return 0;
+}